@@ -0,0 +1,141 @@
+#pragma once
+
+// CRC-16 and CRC-32 shared by the ROV GUI and the Pixhawk firmware.
+//
+//   CRC-16/MCRF4XX (the MAVLink X.25 CRC): reflected poly 0x8408, init 0xFFFF.
+//   Used on every control and telemetry packet. Check value 0x6F91.
+//   CRC-32 (IEEE 802.3): reflected poly 0xEDB88320, init/xorout 0xFFFFFFFF.
+//   Used for larger blocks. Check value 0xCBF43926.
+//
+// Lookup tables are generated at compile time. There are three variants of each:
+//   slice8   - 8 tables, 8 bytes per step. Fastest on the PC.
+//   bytewise - 1 table, 1 byte per step.
+//   nibble   - 16 entries, 2 steps per byte. Small enough for the STM32F427's flash/cache.
+// crc16()/crc32() pick slice8 on the host and nibble on ARM. Tables that are
+// never referenced are not emitted into the image.
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__arm__) || defined(__thumb__)
+#define ROV_CRC_SMALL_TABLE 1
+#else
+#define ROV_CRC_SMALL_TABLE 0
+#endif
+
+static constexpr uint16_t CRC16_POLY = 0x8408;
+static constexpr uint16_t CRC16_INIT = 0xFFFF;
+static constexpr uint32_t CRC32_POLY = 0xEDB88320u;
+static constexpr uint32_t CRC32_INIT = 0xFFFFFFFFu;
+
+// ============== Compile-time table generation ==============
+template <typename T>
+struct CrcSliceTables {
+    T table[8][256];
+};
+
+template <typename T>
+struct CrcNibbleTable {
+    T table[16];
+};
+
+template <typename T>
+constexpr CrcSliceTables<T> crc_make_slice_tables(T poly) {
+    CrcSliceTables<T> t = {};
+    for (unsigned i = 0; i < 256; i++) {
+        T crc = (T)i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (T)((crc >> 1) ^ poly) : (T)(crc >> 1);
+        }
+        t.table[0][i] = crc;
+    }
+    // table[k][i] = CRC of byte i followed by k zero bytes
+    for (unsigned k = 1; k < 8; k++) {
+        for (unsigned i = 0; i < 256; i++) {
+            T prev = t.table[k - 1][i];
+            t.table[k][i] = (T)((prev >> 8) ^ t.table[0][prev & 0xFF]);
+        }
+    }
+    return t;
+}
+
+template <typename T>
+constexpr CrcNibbleTable<T> crc_make_nibble_table(T poly) {
+    CrcNibbleTable<T> t = {};
+    for (unsigned i = 0; i < 16; i++) {
+        T crc = (T)i;
+        for (int bit = 0; bit < 4; bit++) {
+            crc = (crc & 1) ? (T)((crc >> 1) ^ poly) : (T)(crc >> 1);
+        }
+        t.table[i] = crc;
+    }
+    return t;
+}
+
+inline constexpr CrcSliceTables<uint16_t> CRC16_TABLES = crc_make_slice_tables<uint16_t>(CRC16_POLY);
+inline constexpr CrcSliceTables<uint32_t> CRC32_TABLES = crc_make_slice_tables<uint32_t>(CRC32_POLY);
+inline constexpr CrcNibbleTable<uint16_t> CRC16_NIBBLE = crc_make_nibble_table<uint16_t>(CRC16_POLY);
+inline constexpr CrcNibbleTable<uint32_t> CRC32_NIBBLE = crc_make_nibble_table<uint32_t>(CRC32_POLY);
+
+static_assert(CRC16_TABLES.table[0][1] == 0x1189, "CRC-16 table generation");
+static_assert(CRC32_TABLES.table[0][1] == 0x77073096u, "CRC-32 table generation");
+
+// ============== Update functions (no init/xorout applied) ==============
+template <typename T>
+inline T crc_update_bytewise(const CrcSliceTables<T>& t, T crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc = (T)((crc >> 8) ^ t.table[0][(crc ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+template <typename T>
+inline T crc_update_slice8(const CrcSliceTables<T>& t, T crc, const uint8_t* data, size_t len) {
+    while (len >= 8) {
+        uint32_t one = ((uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+                        ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24)) ^ crc;
+        uint32_t two = (uint32_t)data[4] | ((uint32_t)data[5] << 8) |
+                       ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+        crc = (T)(t.table[7][one & 0xFF] ^ t.table[6][(one >> 8) & 0xFF] ^
+                  t.table[5][(one >> 16) & 0xFF] ^ t.table[4][one >> 24] ^
+                  t.table[3][two & 0xFF] ^ t.table[2][(two >> 8) & 0xFF] ^
+                  t.table[1][(two >> 16) & 0xFF] ^ t.table[0][two >> 24]);
+        data += 8;
+        len -= 8;
+    }
+    return crc_update_bytewise(t, crc, data, len);
+}
+
+template <typename T>
+inline T crc_update_nibble(const CrcNibbleTable<T>& t, T crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc = (T)((crc >> 4) ^ t.table[(crc ^ data[i]) & 0x0F]);
+        crc = (T)((crc >> 4) ^ t.table[(crc ^ (data[i] >> 4)) & 0x0F]);
+    }
+    return crc;
+}
+
+inline uint16_t crc16_update(uint16_t crc, const uint8_t* data, size_t len) {
+#if ROV_CRC_SMALL_TABLE
+    return crc_update_nibble(CRC16_NIBBLE, crc, data, len);
+#else
+    return crc_update_slice8(CRC16_TABLES, crc, data, len);
+#endif
+}
+
+inline uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
+#if ROV_CRC_SMALL_TABLE
+    return crc_update_nibble(CRC32_NIBBLE, crc, data, len);
+#else
+    return crc_update_slice8(CRC32_TABLES, crc, data, len);
+#endif
+}
+
+// ============== One-shot helpers ==============
+inline uint16_t crc16(const uint8_t* data, size_t len) {
+    return crc16_update(CRC16_INIT, data, len);
+}
+
+inline uint32_t crc32(const uint8_t* data, size_t len) {
+    return crc32_update(CRC32_INIT, data, len) ^ CRC32_INIT;
+}
@@ -0,0 +1,547 @@
+#pragma once
+
+// Wire protocol shared by the ROV GUI and the Pixhawk firmware.
+// Structures in this header are packed and little-endian, so their in-memory
+// layout is exactly what goes over the link on both sides. The static_asserts
+// pin every offset; changing one is a protocol change for both builds.
+
+#include "rov_crc.h"
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "rov_protocol.h assumes a little-endian target"
+#endif
+
+#define ROV_PACKED __attribute__((packed))
+
+// ============== Field encode/decode ==============
+// Little-endian accessors for unaligned wire buffers. GCC and Clang fold the
+// byte shifts into single loads/stores on little-endian targets, including
+// the Cortex-M4, which handles unaligned word access in hardware.
+constexpr void wire_put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+constexpr void wire_put_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+constexpr uint16_t wire_get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+constexpr uint32_t wire_get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline void wire_put_f32(uint8_t* p, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    wire_put_u32(p, bits);
+}
+
+inline float wire_get_f32(const uint8_t* p) {
+    uint32_t bits = wire_get_u32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Quantize v * scale to the nearest integer, saturating at [lo, hi]. NaN encodes as 0.
+inline int32_t wire_quantize(float v, float scale, int32_t lo, int32_t hi) {
+    float q = v * scale;
+    if (q != q) return 0;
+    if (q <= (float)lo) return lo;
+    if (q >= (float)hi) return hi;
+    return (int32_t)(q < 0.0f ? q - 0.5f : q + 0.5f);
+}
+
+enum PacketType {
+    PACKET_TYPE_CONTROL = 1,
+    PACKET_TYPE_TELEMETRY = 2,
+    PACKET_TYPE_TELEMETRY_DELTA = 3,
+    PACKET_TYPE_PARAM = 4
+};
+
+// ============== Control (GUI -> firmware) ==============
+struct ROV_PACKED MotorCommand {
+    uint8_t motor_id;
+    float throttle;
+    uint8_t enabled;
+};
+
+struct ROV_PACKED ControlPacket {
+    uint8_t packet_type;
+    uint16_t sequence;       // incremented per packet sent, wraps
+    uint32_t timestamp_ms;   // sender's monotonic clock
+    uint8_t motor_count;
+    MotorCommand motors[8];
+    uint8_t armed;
+    uint8_t flight_mode;
+    uint8_t flags;  // ControlFlags
+    uint16_t crc;  // CRC-16 of every preceding byte
+};
+
+enum ControlFlags {
+    CONTROL_FLAG_REQUEST_KEYFRAME = 0x01,  // send a full telemetry packet soon
+    CONTROL_FLAG_REQUEST_CONFIG = 0x02     // send the PID, camera and water groups
+};
+
+static constexpr uint16_t CONTROL_PACKET_SIZE = 61;
+
+static_assert(sizeof(MotorCommand) == 6, "MotorCommand wire size");
+static_assert(offsetof(MotorCommand, throttle) == 1, "MotorCommand layout");
+static_assert(offsetof(MotorCommand, enabled) == 5, "MotorCommand layout");
+static_assert(offsetof(ControlPacket, sequence) == 1, "ControlPacket layout");
+static_assert(offsetof(ControlPacket, timestamp_ms) == 3, "ControlPacket layout");
+static_assert(offsetof(ControlPacket, motor_count) == 7, "ControlPacket layout");
+static_assert(offsetof(ControlPacket, motors) == 8, "ControlPacket layout");
+static_assert(offsetof(ControlPacket, armed) == 56, "ControlPacket layout");
+static_assert(offsetof(ControlPacket, flight_mode) == 57, "ControlPacket layout");
+static_assert(offsetof(ControlPacket, flags) == 58, "ControlPacket layout");
+static_assert(offsetof(ControlPacket, crc) == CONTROL_PACKET_SIZE - 2, "ControlPacket layout");
+static_assert(sizeof(ControlPacket) == CONTROL_PACKET_SIZE, "ControlPacket wire size");
+
+// ============== Telemetry (firmware -> GUI) ==============
+struct ROV_PACKED SensorData {
+    float gyro_x, gyro_y, gyro_z;
+    float accel_x, accel_y, accel_z;
+    float mag_x, mag_y, mag_z;
+    float depth;
+    float temperature;
+    float pressure;
+};
+
+struct ROV_PACKED BatteryData {
+    float voltage;
+    float current;
+    float capacity_mah;
+    uint8_t percentage;
+};
+
+struct ROV_PACKED CameraData {
+    uint8_t camera_type;
+    float servo_min_pwm;
+    float servo_max_pwm;
+    uint8_t gimbal_type;
+};
+
+struct ROV_PACKED WaterSensorData {
+    int32_t pressure_offset;
+    float temp_offset;
+    uint8_t salinity_type;
+};
+
+struct ROV_PACKED PIDTuning {
+    float roll_p, roll_i, roll_d;
+    float pitch_p, pitch_i, pitch_d;
+    float yaw_p, yaw_i, yaw_d;
+    float depth_p, depth_i, depth_d;
+};
+
+// Firmware link load, measured over the last second
+struct ROV_PACKED LinkUtilization {
+    uint16_t tx_bytes_per_s;
+    uint16_t capacity_bytes_per_s;  // line rate: baud / 10
+    uint16_t deferred_per_s;        // due groups postponed by the byte budget
+    uint16_t control_rx_per_s;      // control packets accepted
+    uint16_t control_errors;        // control frames rejected by CRC since boot, saturating
+};
+
+// Firmware cooperative scheduler tasks, in TaskTiming order
+enum FirmwareTask {
+    TASK_SENSORS = 0,
+    TASK_CONTROL,
+    TASK_PWM,
+    TASK_TELEMETRY,
+    TASK_COUNT
+};
+
+// One task's execution time over the last second
+struct ROV_PACKED TaskTimingEntry {
+    uint16_t rate_hz;    // runs in the last second
+    uint16_t avg_us;
+    uint16_t max_us;
+    uint16_t overruns;   // since boot, saturating: released a period late or ran longer than its period
+};
+
+struct ROV_PACKED TaskTiming {
+    TaskTimingEntry tasks[TASK_COUNT];
+};
+
+struct ROV_PACKED RobotState {
+    uint8_t armed;
+    uint8_t flight_mode;
+    SensorData sensors;
+    BatteryData battery;
+    CameraData camera;
+    WaterSensorData water;
+    PIDTuning pid_tuning;
+    float roll, pitch, yaw;
+    LinkUtilization link;
+    TaskTiming timing;
+};
+
+struct ROV_PACKED TelemetryPacket {
+    uint8_t packet_type;
+    uint16_t sequence;       // incremented per packet sent, wraps
+    uint32_t timestamp_ms;   // firmware monotonic clock
+    uint16_t control_echo;   // sequence of the last control packet the firmware accepted
+    RobotState state;
+    uint16_t crc;  // CRC-16 of every preceding byte
+};
+
+static constexpr uint16_t TELEMETRY_PACKET_SIZE = 195;
+
+static_assert(sizeof(SensorData) == 48, "SensorData wire size");
+static_assert(offsetof(SensorData, depth) == 36, "SensorData layout");
+static_assert(sizeof(BatteryData) == 13, "BatteryData wire size");
+static_assert(offsetof(BatteryData, percentage) == 12, "BatteryData layout");
+static_assert(sizeof(CameraData) == 10, "CameraData wire size");
+static_assert(offsetof(CameraData, gimbal_type) == 9, "CameraData layout");
+static_assert(sizeof(WaterSensorData) == 9, "WaterSensorData wire size");
+static_assert(offsetof(WaterSensorData, salinity_type) == 8, "WaterSensorData layout");
+static_assert(sizeof(PIDTuning) == 48, "PIDTuning wire size");
+static_assert(offsetof(RobotState, sensors) == 2, "RobotState layout");
+static_assert(offsetof(RobotState, battery) == 50, "RobotState layout");
+static_assert(offsetof(RobotState, camera) == 63, "RobotState layout");
+static_assert(offsetof(RobotState, water) == 73, "RobotState layout");
+static_assert(offsetof(RobotState, pid_tuning) == 82, "RobotState layout");
+static_assert(offsetof(RobotState, roll) == 130, "RobotState layout");
+static_assert(sizeof(LinkUtilization) == 10, "LinkUtilization wire size");
+static_assert(offsetof(RobotState, link) == 142, "RobotState layout");
+static_assert(sizeof(TaskTimingEntry) == 8, "TaskTimingEntry wire size");
+static_assert(sizeof(TaskTiming) == 32, "TaskTiming wire size");
+static_assert(offsetof(RobotState, timing) == 152, "RobotState layout");
+static_assert(sizeof(RobotState) == 184, "RobotState wire size");
+static_assert(offsetof(TelemetryPacket, sequence) == 1, "TelemetryPacket layout");
+static_assert(offsetof(TelemetryPacket, timestamp_ms) == 3, "TelemetryPacket layout");
+static_assert(offsetof(TelemetryPacket, control_echo) == 7, "TelemetryPacket layout");
+static_assert(offsetof(TelemetryPacket, state) == 9, "TelemetryPacket layout");
+static_assert(offsetof(TelemetryPacket, crc) == TELEMETRY_PACKET_SIZE - 2, "TelemetryPacket layout");
+static_assert(sizeof(TelemetryPacket) == TELEMETRY_PACKET_SIZE, "TelemetryPacket wire size");
+
+// ============== Packet encode/decode ==============
+// The packed structs are the wire layout, so these are block copies plus the
+// trailing CRC-16. encode_* always computes the CRC; decode_* rejects a
+// wrong packet type, short input or CRC mismatch.
+inline uint16_t encode_control_packet(const ControlPacket& packet, uint8_t* out) {
+    memcpy(out, &packet, CONTROL_PACKET_SIZE - 2);
+    wire_put_u16(out + CONTROL_PACKET_SIZE - 2, crc16(out, CONTROL_PACKET_SIZE - 2));
+    return CONTROL_PACKET_SIZE;
+}
+
+inline bool decode_control_packet(const uint8_t* in, uint16_t len, ControlPacket& packet) {
+    if (len < CONTROL_PACKET_SIZE || in[0] != PACKET_TYPE_CONTROL) return false;
+    if (crc16(in, CONTROL_PACKET_SIZE - 2) != wire_get_u16(in + CONTROL_PACKET_SIZE - 2)) return false;
+    memcpy(&packet, in, CONTROL_PACKET_SIZE);
+    return true;
+}
+
+inline uint16_t encode_telemetry_packet(const TelemetryPacket& packet, uint8_t* out) {
+    memcpy(out, &packet, TELEMETRY_PACKET_SIZE - 2);
+    wire_put_u16(out + TELEMETRY_PACKET_SIZE - 2, crc16(out, TELEMETRY_PACKET_SIZE - 2));
+    return TELEMETRY_PACKET_SIZE;
+}
+
+inline bool decode_telemetry_packet(const uint8_t* in, uint16_t len, TelemetryPacket& packet) {
+    if (len < TELEMETRY_PACKET_SIZE || in[0] != PACKET_TYPE_TELEMETRY) return false;
+    if (crc16(in, TELEMETRY_PACKET_SIZE - 2) != wire_get_u16(in + TELEMETRY_PACKET_SIZE - 2)) return false;
+    memcpy(&packet, in, TELEMETRY_PACKET_SIZE);
+    return true;
+}
+
+// ============== Parameters (both directions) ==============
+// Persistent vehicle parameters, read and written one at a time. The GUI sends
+// READ or WRITE; the firmware answers every request with a VALUE packet carrying
+// the parameter's current value. Writes take effect at once and are saved to
+// flash shortly after. Every value travels as a float; integer parameters are
+// exact.
+enum ParamOp {
+    PARAM_OP_READ = 0,   // GUI -> firmware; param_id may be PARAM_ID_ALL
+    PARAM_OP_WRITE = 1,  // GUI -> firmware
+    PARAM_OP_VALUE = 2   // firmware -> GUI
+};
+
+enum ParamStatus {
+    PARAM_STATUS_OK = 0,
+    PARAM_STATUS_UNKNOWN_ID = 1,
+    PARAM_STATUS_INVALID = 2  // write rejected; value is the unchanged current value
+};
+
+enum ParamId {
+    PARAM_FRAME_TYPE = 0,     // FrameType; resets motor reversal to the frame's default
+    PARAM_MOTOR_REVERSED,     // bit per motor
+    PARAM_THRUST_FACTOR_1,    // 1..8: thruster output relative to nominal, 0.5 - 2.0
+    PARAM_PID_ROLL_P = PARAM_THRUST_FACTOR_1 + 8,
+    PARAM_PID_ROLL_I,
+    PARAM_PID_ROLL_D,
+    PARAM_PID_PITCH_P,
+    PARAM_PID_PITCH_I,
+    PARAM_PID_PITCH_D,
+    PARAM_PID_YAW_P,
+    PARAM_PID_YAW_I,
+    PARAM_PID_YAW_D,
+    PARAM_PID_DEPTH_P,
+    PARAM_PID_DEPTH_I,
+    PARAM_PID_DEPTH_D,
+    PARAM_COUNT
+};
+
+static constexpr uint8_t PARAM_ID_ALL = 0xFF;
+
+struct ROV_PACKED ParamPacket {
+    uint8_t packet_type;
+    uint8_t op;        // ParamOp
+    uint8_t param_id;  // ParamId
+    uint8_t status;    // ParamStatus in VALUE replies, 0 otherwise
+    float value;
+    uint16_t crc;  // CRC-16 of every preceding byte
+};
+
+static constexpr uint16_t PARAM_PACKET_SIZE = 10;
+
+static_assert(offsetof(ParamPacket, param_id) == 2, "ParamPacket layout");
+static_assert(offsetof(ParamPacket, value) == 4, "ParamPacket layout");
+static_assert(offsetof(ParamPacket, crc) == PARAM_PACKET_SIZE - 2, "ParamPacket layout");
+static_assert(sizeof(ParamPacket) == PARAM_PACKET_SIZE, "ParamPacket wire size");
+static_assert(PARAM_COUNT <= 32, "pending parameter replies are tracked in a 32-bit mask");
+
+inline uint16_t encode_param_packet(const ParamPacket& packet, uint8_t* out) {
+    memcpy(out, &packet, PARAM_PACKET_SIZE - 2);
+    wire_put_u16(out + PARAM_PACKET_SIZE - 2, crc16(out, PARAM_PACKET_SIZE - 2));
+    return PARAM_PACKET_SIZE;
+}
+
+inline bool decode_param_packet(const uint8_t* in, uint16_t len, ParamPacket& packet) {
+    if (len < PARAM_PACKET_SIZE || in[0] != PACKET_TYPE_PARAM) return false;
+    if (crc16(in, PARAM_PACKET_SIZE - 2) != wire_get_u16(in + PARAM_PACKET_SIZE - 2)) return false;
+    memcpy(&packet, in, PARAM_PACKET_SIZE);
+    return true;
+}
+
+// ============== Telemetry delta frames ==============
+// Between full TelemetryPacket keyframes the firmware sends delta frames holding
+// only the field groups that are due. Group values are absolute, not differences,
+// so a lost delta frame leaves the receiver briefly stale rather than wrong.
+// Battery capacity, the only field not covered by a group, travels in keyframes.
+//
+//   [type=3][length][sequence u16][timestamp_ms u32][control_echo u16][groups u16]
+//   [payload of each set group, in bit order][crc u16]
+//
+// length is the whole frame including the CRC.
+enum TelemetryDeltaGroup {
+    DELTA_GROUP_ATTITUDE = 0,   // roll, pitch, yaw: int16 binary angle, wrapped to [-180, 180) deg
+    DELTA_GROUP_GYRO,           // x, y, z: int16, 0.001 units
+    DELTA_GROUP_ACCEL,          // x, y, z: int16, 0.001 m/s^2
+    DELTA_GROUP_MAG,            // x, y, z: int16, 0.01 units
+    DELTA_GROUP_DEPTH,          // depth: int32 mm
+    DELTA_GROUP_ENVIRONMENT,    // temperature: int16 0.01 C, pressure: uint32 Pa
+    DELTA_GROUP_BATTERY,        // voltage: uint16 mV, current: int16 10mA, percentage: uint8
+    DELTA_GROUP_STATUS,         // armed, flight_mode
+    DELTA_GROUP_LINK,           // LinkUtilization as-is
+    DELTA_GROUP_PID,            // PIDTuning as-is (float gains are not quantized)
+    DELTA_GROUP_CAMERA,         // CameraData as-is
+    DELTA_GROUP_WATER,          // WaterSensorData as-is
+    DELTA_GROUP_TIMING,         // TaskTiming as-is
+    DELTA_GROUP_COUNT
+};
+
+static constexpr uint8_t DELTA_GROUP_SIZES[DELTA_GROUP_COUNT] = {
+    6, 6, 6, 6, 4, 6, 5, 2,
+    sizeof(LinkUtilization), sizeof(PIDTuning), sizeof(CameraData), sizeof(WaterSensorData),
+    sizeof(TaskTiming)
+};
+static constexpr uint8_t DELTA_GROUP_MAX_SIZE = sizeof(PIDTuning);
+
+struct ROV_PACKED TelemetryDeltaHeader {
+    uint8_t packet_type;
+    uint8_t length;
+    uint16_t sequence;
+    uint32_t timestamp_ms;
+    uint16_t control_echo;
+    uint16_t groups;  // bit n set = DELTA_GROUP n follows
+};
+
+static constexpr uint16_t TELEMETRY_DELTA_HEADER_SIZE = 12;
+static constexpr uint16_t TELEMETRY_DELTA_MIN_SIZE = TELEMETRY_DELTA_HEADER_SIZE + 2;
+
+constexpr uint16_t delta_all_groups_size() {
+    uint16_t size = 0;
+    for (uint8_t g = 0; g < DELTA_GROUP_COUNT; g++) size += DELTA_GROUP_SIZES[g];
+    return size;
+}
+
+static constexpr uint16_t TELEMETRY_DELTA_MAX_SIZE = TELEMETRY_DELTA_MIN_SIZE + delta_all_groups_size();
+
+static_assert(sizeof(TelemetryDeltaHeader) == TELEMETRY_DELTA_HEADER_SIZE, "TelemetryDeltaHeader wire size");
+static_assert(offsetof(TelemetryDeltaHeader, sequence) == 2, "TelemetryDeltaHeader layout");
+static_assert(offsetof(TelemetryDeltaHeader, groups) == 10, "TelemetryDeltaHeader layout");
+static_assert(DELTA_GROUP_COUNT <= 16, "delta group mask is 16 bits");
+static_assert(TELEMETRY_DELTA_MAX_SIZE <= 255, "delta length is one byte");
+
+static constexpr float DELTA_ANGLE_SCALE = 65536.0f / 360.0f;
+
+inline int16_t delta_quantize_angle(float degrees) {
+    float wrapped = degrees - 360.0f * floorf((degrees + 180.0f) / 360.0f);
+    return (int16_t)wire_quantize(wrapped, DELTA_ANGLE_SCALE, -32768, 32767);
+}
+
+inline void delta_put_i16(uint8_t* p, float v, float scale) {
+    wire_put_u16(p, (uint16_t)(int16_t)wire_quantize(v, scale, -32768, 32767));
+}
+
+inline float delta_get_i16(const uint8_t* p, float scale) {
+    return (float)(int16_t)wire_get_u16(p) / scale;
+}
+
+// Write one group's payload for state. Returns DELTA_GROUP_SIZES[group].
+inline uint8_t telemetry_delta_write_group(uint8_t group, const RobotState& state, uint8_t* out) {
+    const SensorData& s = state.sensors;
+    switch (group) {
+    case DELTA_GROUP_ATTITUDE:
+        wire_put_u16(out + 0, (uint16_t)delta_quantize_angle(state.roll));
+        wire_put_u16(out + 2, (uint16_t)delta_quantize_angle(state.pitch));
+        wire_put_u16(out + 4, (uint16_t)delta_quantize_angle(state.yaw));
+        break;
+    case DELTA_GROUP_GYRO:
+        delta_put_i16(out + 0, s.gyro_x, 1000.0f);
+        delta_put_i16(out + 2, s.gyro_y, 1000.0f);
+        delta_put_i16(out + 4, s.gyro_z, 1000.0f);
+        break;
+    case DELTA_GROUP_ACCEL:
+        delta_put_i16(out + 0, s.accel_x, 1000.0f);
+        delta_put_i16(out + 2, s.accel_y, 1000.0f);
+        delta_put_i16(out + 4, s.accel_z, 1000.0f);
+        break;
+    case DELTA_GROUP_MAG:
+        delta_put_i16(out + 0, s.mag_x, 100.0f);
+        delta_put_i16(out + 2, s.mag_y, 100.0f);
+        delta_put_i16(out + 4, s.mag_z, 100.0f);
+        break;
+    case DELTA_GROUP_DEPTH:
+        wire_put_u32(out, (uint32_t)wire_quantize(s.depth, 1000.0f, -2000000000, 2000000000));
+        break;
+    case DELTA_GROUP_ENVIRONMENT:
+        delta_put_i16(out + 0, s.temperature, 100.0f);
+        wire_put_u32(out + 2, (uint32_t)wire_quantize(s.pressure, 1.0f, 0, 2000000000));
+        break;
+    case DELTA_GROUP_BATTERY:
+        wire_put_u16(out + 0, (uint16_t)wire_quantize(state.battery.voltage, 1000.0f, 0, 65535));
+        delta_put_i16(out + 2, state.battery.current, 100.0f);
+        out[4] = state.battery.percentage;
+        break;
+    case DELTA_GROUP_STATUS:
+        out[0] = state.armed;
+        out[1] = state.flight_mode;
+        break;
+    case DELTA_GROUP_LINK:
+        memcpy(out, &state.link, sizeof(state.link));
+        break;
+    case DELTA_GROUP_PID:
+        memcpy(out, &state.pid_tuning, sizeof(state.pid_tuning));
+        break;
+    case DELTA_GROUP_CAMERA:
+        memcpy(out, &state.camera, sizeof(state.camera));
+        break;
+    case DELTA_GROUP_WATER:
+        memcpy(out, &state.water, sizeof(state.water));
+        break;
+    case DELTA_GROUP_TIMING:
+        memcpy(out, &state.timing, sizeof(state.timing));
+        break;
+    default:
+        return 0;
+    }
+    return DELTA_GROUP_SIZES[group];
+}
+
+// Apply one group's payload to state. Returns DELTA_GROUP_SIZES[group].
+inline uint8_t telemetry_delta_read_group(uint8_t group, const uint8_t* in, RobotState& state) {
+    SensorData& s = state.sensors;
+    switch (group) {
+    case DELTA_GROUP_ATTITUDE:
+        state.roll = delta_get_i16(in + 0, DELTA_ANGLE_SCALE);
+        state.pitch = delta_get_i16(in + 2, DELTA_ANGLE_SCALE);
+        state.yaw = delta_get_i16(in + 4, DELTA_ANGLE_SCALE);
+        break;
+    case DELTA_GROUP_GYRO:
+        s.gyro_x = delta_get_i16(in + 0, 1000.0f);
+        s.gyro_y = delta_get_i16(in + 2, 1000.0f);
+        s.gyro_z = delta_get_i16(in + 4, 1000.0f);
+        break;
+    case DELTA_GROUP_ACCEL:
+        s.accel_x = delta_get_i16(in + 0, 1000.0f);
+        s.accel_y = delta_get_i16(in + 2, 1000.0f);
+        s.accel_z = delta_get_i16(in + 4, 1000.0f);
+        break;
+    case DELTA_GROUP_MAG:
+        s.mag_x = delta_get_i16(in + 0, 100.0f);
+        s.mag_y = delta_get_i16(in + 2, 100.0f);
+        s.mag_z = delta_get_i16(in + 4, 100.0f);
+        break;
+    case DELTA_GROUP_DEPTH:
+        s.depth = (float)(int32_t)wire_get_u32(in) / 1000.0f;
+        break;
+    case DELTA_GROUP_ENVIRONMENT:
+        s.temperature = delta_get_i16(in + 0, 100.0f);
+        s.pressure = (float)wire_get_u32(in + 2);
+        break;
+    case DELTA_GROUP_BATTERY:
+        state.battery.voltage = (float)wire_get_u16(in + 0) / 1000.0f;
+        state.battery.current = delta_get_i16(in + 2, 100.0f);
+        state.battery.percentage = in[4];
+        break;
+    case DELTA_GROUP_STATUS:
+        state.armed = in[0];
+        state.flight_mode = in[1];
+        break;
+    case DELTA_GROUP_LINK:
+        memcpy(&state.link, in, sizeof(state.link));
+        break;
+    case DELTA_GROUP_PID:
+        memcpy(&state.pid_tuning, in, sizeof(state.pid_tuning));
+        break;
+    case DELTA_GROUP_CAMERA:
+        memcpy(&state.camera, in, sizeof(state.camera));
+        break;
+    case DELTA_GROUP_WATER:
+        memcpy(&state.water, in, sizeof(state.water));
+        break;
+    case DELTA_GROUP_TIMING:
+        memcpy(&state.timing, in, sizeof(state.timing));
+        break;
+    default:
+        return 0;
+    }
+    return DELTA_GROUP_SIZES[group];
+}
+
+// Payload size implied by a group mask, or -1 if it names an unknown group
+inline int telemetry_delta_payload_size(uint16_t groups) {
+    int size = 0;
+    for (uint8_t g = 0; g < 16; g++) {
+        if (!(groups & (1u << g))) continue;
+        if (g >= DELTA_GROUP_COUNT) return -1;
+        size += DELTA_GROUP_SIZES[g];
+    }
+    return size;
+}
+
+// Checks type, length, CRC and that the group mask matches the length.
+// On success header is filled and the payload starts at in + TELEMETRY_DELTA_HEADER_SIZE.
+inline bool decode_telemetry_delta_header(const uint8_t* in, uint16_t len, TelemetryDeltaHeader& header) {
+    if (len < TELEMETRY_DELTA_MIN_SIZE || in[0] != PACKET_TYPE_TELEMETRY_DELTA) return false;
+    uint8_t frame_len = in[1];
+    if (frame_len < TELEMETRY_DELTA_MIN_SIZE || frame_len > TELEMETRY_DELTA_MAX_SIZE || frame_len > len) return false;
+    if (crc16(in, frame_len - 2) != wire_get_u16(in + frame_len - 2)) return false;
+    memcpy(&header, in, TELEMETRY_DELTA_HEADER_SIZE);
+    return telemetry_delta_payload_size(header.groups) == frame_len - TELEMETRY_DELTA_MIN_SIZE;
+}
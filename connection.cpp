@@ -7,14 +7,148 @@
 #include <errno.h>
 #include <cstring>
 #include <termios.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+// ============== Event Loop ==============
+EventLoop::EventLoop() {
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    m_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    
+    if (m_epoll_fd >= 0 && m_wake_fd >= 0) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = m_wake_fd;
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &ev);
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (m_wake_fd >= 0) close(m_wake_fd);
+    if (m_epoll_fd >= 0) close(m_epoll_fd);
+}
+
+bool EventLoop::add(int fd, uint32_t events, Callback callback) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        return false;
+    }
+    m_callbacks[fd] = callback;
+    return true;
+}
+
+bool EventLoop::modify(int fd, uint32_t events) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void EventLoop::remove(int fd) {
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    m_callbacks.erase(fd);
+}
+
+int EventLoop::wait(int timeout_ms) {
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(m_epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (n < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    
+    int dispatched = 0;
+    for (int i = 0; i < n; i++) {
+        int fd = events[i].data.fd;
+        if (fd == m_wake_fd) {
+            uint64_t value;
+            ssize_t ignored = read(m_wake_fd, &value, sizeof(value));
+            (void)ignored;
+            continue;
+        }
+        
+        // An earlier callback in this batch may have removed the fd
+        auto it = m_callbacks.find(fd);
+        if (it == m_callbacks.end()) continue;
+        
+        // Copy, since the callback is allowed to remove itself
+        Callback callback = it->second;
+        callback(events[i].events);
+        dispatched++;
+    }
+    return dispatched;
+}
+
+void EventLoop::wake() {
+    uint64_t value = 1;
+    ssize_t ignored = write(m_wake_fd, &value, sizeof(value));
+    (void)ignored;
+}
 
 // ============== Connection Base Class ==============
-Connection::Connection() {}
+Connection::Connection() : m_loop(nullptr) {}
 Connection::~Connection() {}
 
+bool Connection::attach(EventLoop& loop, ReceiveHandler handler) {
+    detach();
+    
+    int fd = get_fd();
+    if (fd < 0) {
+        m_error = "Not connected";
+        return false;
+    }
+    
+    // A pending connect is confirmed through EPOLLOUT before reads start
+    uint32_t events = is_connecting() ? EPOLLOUT : EPOLLIN;
+    if (!loop.add(fd, events, [this](uint32_t ready) { handle_events(ready); })) {
+        m_error = "Failed to register with event loop";
+        return false;
+    }
+    
+    m_loop = &loop;
+    m_handler = handler;
+    return true;
+}
+
+void Connection::detach() {
+    if (m_loop) {
+        m_loop->remove(get_fd());
+        m_loop = nullptr;
+    }
+}
+
+void Connection::handle_events(uint32_t events) {
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        drain();
+    }
+    
+    // Peer closed or the device went away - stop polling a dead fd
+    if (is_connected() && (events & EPOLLHUP)) {
+        m_error = "Connection closed";
+        disconnect();
+    } else if (!is_connected()) {
+        disconnect();
+    }
+}
+
+void Connection::drain() {
+    // Level-triggered, but read until the fd is empty so one wakeup handles a burst
+    uint8_t buffer[4096];
+    uint16_t received_len = 0;
+    while (is_connected() && receive(buffer, sizeof(buffer), received_len) && received_len > 0) {
+        if (m_handler) {
+            m_handler(buffer, received_len);
+        }
+    }
+}
+
 // ============== TCP Connection ==============
 TCPConnection::TCPConnection(const std::string& host, uint16_t port)
-    : m_host(host), m_port(port), m_socket(-1), m_connected(false) {}
+    : m_host(host), m_port(port), m_socket(-1), m_connected(false), m_connecting(false) {}
 
 TCPConnection::~TCPConnection() {
     disconnect();
@@ -43,17 +177,48 @@ bool TCPConnection::connect() {
         return false;
     }
     
-    m_connected = true;
+    // EINPROGRESS: completion is confirmed by EPOLLOUT + SO_ERROR in handle_events()
+    m_connected = (result == 0);
+    m_connecting = !m_connected;
     m_error = "";
     return true;
 }
 
 void TCPConnection::disconnect() {
+    detach();
     if (m_socket >= 0) {
         close(m_socket);
         m_socket = -1;
     }
     m_connected = false;
+    m_connecting = false;
+}
+
+void TCPConnection::handle_events(uint32_t events) {
+    if (!m_connecting) {
+        Connection::handle_events(events);
+        return;
+    }
+    
+    if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) return;
+    
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+    if (getsockopt(m_socket, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0) {
+        err = errno;
+    }
+    
+    m_connecting = false;
+    if (err != 0) {
+        m_error = "Failed to connect to " + m_host + ":" + std::to_string(m_port) + ": " + strerror(err);
+        disconnect();
+        return;
+    }
+    
+    m_connected = true;
+    if (m_loop) {
+        m_loop->modify(m_socket, EPOLLIN);
+    }
 }
 
 bool TCPConnection::is_connected() const {
@@ -102,7 +267,26 @@ bool TCPConnection::receive(uint8_t* buffer, uint16_t buffer_size, uint16_t& rec
 
 // ============== UDP Connection ==============
 UDPConnection::UDPConnection(const std::string& host, uint16_t port)
-    : m_host(host), m_port(port), m_socket(-1), m_connected(false) {}
+    : m_host(host), m_port(port), m_socket(-1), m_connected(false), m_tx_count(0) {
+    memset(m_rx_msgs, 0, sizeof(m_rx_msgs));
+    memset(m_tx_msgs, 0, sizeof(m_tx_msgs));
+    memset(&m_stats, 0, sizeof(m_stats));
+    
+    // Point every message header at its own buffer once; the kernel only fills in lengths
+    for (unsigned i = 0; i < UDP_BATCH_SIZE; i++) {
+        m_rx_iovs[i].iov_base = m_rx_buffers[i];
+        m_rx_iovs[i].iov_len = UDP_MAX_DATAGRAM;
+        m_rx_msgs[i].msg_hdr.msg_iov = &m_rx_iovs[i];
+        m_rx_msgs[i].msg_hdr.msg_iovlen = 1;
+        m_rx_datagrams[i].data = m_rx_buffers[i];
+        m_rx_datagrams[i].len = 0;
+        
+        m_tx_iovs[i].iov_base = m_tx_buffers[i];
+        m_tx_iovs[i].iov_len = 0;
+        m_tx_msgs[i].msg_hdr.msg_iov = &m_tx_iovs[i];
+        m_tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+}
 
 UDPConnection::~UDPConnection() {
     disconnect();
@@ -136,11 +320,13 @@ bool UDPConnection::connect() {
 }
 
 void UDPConnection::disconnect() {
+    detach();
     if (m_socket >= 0) {
         close(m_socket);
         m_socket = -1;
     }
     m_connected = false;
+    m_tx_count = 0;
 }
 
 bool UDPConnection::is_connected() const {
@@ -180,6 +366,90 @@ bool UDPConnection::receive(uint8_t* buffer, uint16_t buffer_size, uint16_t& rec
     return true;
 }
 
+DatagramBatch UDPConnection::receive_batch() {
+    DatagramBatch batch;
+    batch.datagrams = m_rx_datagrams;
+    batch.count = 0;
+    if (!is_connected()) return batch;
+    
+    int n = recvmmsg(m_socket, m_rx_msgs, UDP_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+    m_stats.recv_calls++;
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            m_error = "UDP receive error";
+        }
+        m_stats.recv_batch_histogram[0]++;
+        return batch;
+    }
+    
+    for (int i = 0; i < n; i++) {
+        if (m_rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            m_stats.truncated++;
+        }
+        m_rx_datagrams[i].len = (uint16_t)m_rx_msgs[i].msg_len;
+    }
+    
+    batch.count = (unsigned)n;
+    m_stats.recv_datagrams += batch.count;
+    m_stats.recv_batch_histogram[batch.count]++;
+    if (batch.count > m_stats.max_recv_batch) {
+        m_stats.max_recv_batch = batch.count;
+    }
+    return batch;
+}
+
+bool UDPConnection::queue_send(const uint8_t* data, uint16_t len) {
+    if (!is_connected()) {
+        m_error = "Not connected";
+        return false;
+    }
+    if (len > UDP_MAX_DATAGRAM) {
+        m_error = "UDP datagram too large";
+        return false;
+    }
+    if (m_tx_count == UDP_BATCH_SIZE && !flush()) {
+        return false;
+    }
+    
+    memcpy(m_tx_buffers[m_tx_count], data, len);
+    m_tx_iovs[m_tx_count].iov_len = len;
+    m_tx_count++;
+    return true;
+}
+
+bool UDPConnection::flush() {
+    unsigned sent_total = 0;
+    while (sent_total < m_tx_count) {
+        int sent = sendmmsg(m_socket, m_tx_msgs + sent_total, m_tx_count - sent_total, MSG_DONTWAIT);
+        m_stats.send_calls++;
+        if (sent <= 0) {
+            // Socket buffer full or hard error - control data is stale by the next tick anyway
+            m_error = "UDP send failed";
+            m_tx_count = 0;
+            return false;
+        }
+        sent_total += sent;
+        m_stats.send_datagrams += sent;
+    }
+    m_tx_count = 0;
+    return true;
+}
+
+void UDPConnection::handle_events(uint32_t events) {
+    if (!(events & (EPOLLIN | EPOLLERR))) return;
+    
+    // A full batch means more may be waiting
+    DatagramBatch batch;
+    do {
+        batch = receive_batch();
+        for (unsigned i = 0; i < batch.count; i++) {
+            if (m_handler) {
+                m_handler(batch.datagrams[i].data, batch.datagrams[i].len);
+            }
+        }
+    } while (batch.count == UDP_BATCH_SIZE);
+}
+
 // ============== Serial USB Connection ==============
 SerialUSBConnection::SerialUSBConnection(const std::string& port, uint32_t baudrate)
     : m_port(port), m_baudrate(baudrate), m_serial_fd(-1), m_connected(false) {}
@@ -241,6 +511,7 @@ bool SerialUSBConnection::connect() {
 }
 
 void SerialUSBConnection::disconnect() {
+    detach();
     if (m_serial_fd >= 0) {
         close(m_serial_fd);
         m_serial_fd = -1;
@@ -275,6 +546,10 @@ bool SerialUSBConnection::receive(uint8_t* buffer, uint16_t buffer_size, uint16_
     ssize_t n = read(m_serial_fd, buffer, buffer_size);
     if (n < 0) {
         received_len = 0;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            m_error = "Serial read failed";
+            m_connected = false;
+        }
         return false;
     }
     
@@ -336,11 +611,42 @@ bool ConnectionManager::is_connected() const {
     return m_connection->is_connected();
 }
 
+bool ConnectionManager::is_connecting() const {
+    if (!m_connection) return false;
+    return m_connection->is_connecting();
+}
+
+bool ConnectionManager::attach(EventLoop& loop, Connection::ReceiveHandler handler) {
+    if (!m_connection) return false;
+    return m_connection->attach(loop, handler);
+}
+
+void ConnectionManager::detach() {
+    if (m_connection) {
+        m_connection->detach();
+    }
+}
+
 bool ConnectionManager::send(const uint8_t* data, uint16_t len) {
     if (!m_connection) return false;
     return m_connection->send(data, len);
 }
 
+bool ConnectionManager::queue_send(const uint8_t* data, uint16_t len) {
+    if (!m_connection) return false;
+    return m_connection->queue_send(data, len);
+}
+
+bool ConnectionManager::flush() {
+    if (!m_connection) return false;
+    return m_connection->flush();
+}
+
+const UDPBatchStats* ConnectionManager::get_udp_stats() const {
+    if (!m_connection || m_type != CONN_UDP) return nullptr;
+    return &static_cast<const UDPConnection*>(m_connection)->get_batch_stats();
+}
+
 bool ConnectionManager::receive(uint8_t* buffer, uint16_t buffer_size, uint16_t& received_len) {
     if (!m_connection) {
         received_len = 0;
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <cstdint>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 enum ConnectionType {
@@ -10,20 +14,66 @@ enum ConnectionType {
     CONN_SERIAL_USB
 };
 
+// epoll-based reactor. File descriptors register a readiness callback and
+// wait() blocks until one of them is ready or the timeout expires.
+class EventLoop {
+public:
+    typedef std::function<void(uint32_t events)> Callback;
+    
+    EventLoop();
+    ~EventLoop();
+    
+    bool add(int fd, uint32_t events, Callback callback);
+    bool modify(int fd, uint32_t events);
+    void remove(int fd);
+    
+    // Block for up to timeout_ms (-1 = forever) and dispatch ready callbacks.
+    // Returns the number of callbacks run, or -1 on error.
+    int wait(int timeout_ms);
+    
+    // Interrupt a wait() in progress from another thread
+    void wake();
+    
+private:
+    static const int MAX_EVENTS = 16;
+    
+    int m_epoll_fd;
+    int m_wake_fd;
+    std::unordered_map<int, Callback> m_callbacks;
+};
+
 class Connection {
 public:
+    // Called from EventLoop::wait() with each chunk drained from the fd
+    typedef std::function<void(const uint8_t* data, uint16_t len)> ReceiveHandler;
+    
     Connection();
     virtual ~Connection();
     
     virtual bool connect() = 0;
     virtual void disconnect() = 0;
     virtual bool is_connected() const = 0;
+    virtual bool is_connecting() const { return false; }
     virtual bool send(const uint8_t* data, uint16_t len) = 0;
     virtual bool receive(uint8_t* buffer, uint16_t buffer_size, uint16_t& received_len) = 0;
     virtual const std::string& get_error() const { return m_error; }
+    virtual int get_fd() const = 0;
+    
+    // Queue a message for the next flush(). Transports without batching send immediately.
+    virtual bool queue_send(const uint8_t* data, uint16_t len) { return send(data, len); }
+    virtual bool flush() { return true; }
+    
+    // Register with an event loop; received data is drained into handler on each wakeup
+    bool attach(EventLoop& loop, ReceiveHandler handler);
+    void detach();
     
 protected:
+    virtual void handle_events(uint32_t events);
+    void drain();
+    
     std::string m_error;
+    EventLoop* m_loop;
+    ReceiveHandler m_handler;
 };
 
 class TCPConnection : public Connection {
@@ -34,14 +84,46 @@ public:
     bool connect() override;
     void disconnect() override;
     bool is_connected() const override;
+    bool is_connecting() const override { return m_connecting; }
     bool send(const uint8_t* data, uint16_t len) override;
     bool receive(uint8_t* buffer, uint16_t buffer_size, uint16_t& received_len) override;
+    int get_fd() const override { return m_socket; }
+    
+protected:
+    void handle_events(uint32_t events) override;
     
 private:
     std::string m_host;
     uint16_t m_port;
     int m_socket;
     bool m_connected;
+    bool m_connecting;  // non-blocking connect() issued, waiting for EPOLLOUT
+};
+
+static const unsigned UDP_BATCH_SIZE = 32;
+static const uint16_t UDP_MAX_DATAGRAM = 2048;
+
+// One datagram from UDPConnection::receive_batch()
+struct Datagram {
+    const uint8_t* data;
+    uint16_t len;
+};
+
+// View of the datagrams returned by one receive_batch() call.
+// Points into the connection's buffers and is only valid until the next call.
+struct DatagramBatch {
+    const Datagram* datagrams;
+    unsigned count;
+};
+
+struct UDPBatchStats {
+    uint64_t recv_calls;
+    uint64_t recv_datagrams;
+    uint64_t send_calls;
+    uint64_t send_datagrams;
+    uint32_t max_recv_batch;
+    uint32_t truncated;
+    uint64_t recv_batch_histogram[UDP_BATCH_SIZE + 1];  // recvmmsg calls by datagrams returned
 };
 
 class UDPConnection : public Connection {
@@ -54,12 +136,38 @@ public:
     bool is_connected() const override;
     bool send(const uint8_t* data, uint16_t len) override;
     bool receive(uint8_t* buffer, uint16_t buffer_size, uint16_t& received_len) override;
+    int get_fd() const override { return m_socket; }
+    
+    // Read up to UDP_BATCH_SIZE datagrams with a single recvmmsg()
+    DatagramBatch receive_batch();
+    
+    // Queue a datagram and send everything queued with a single sendmmsg()
+    bool queue_send(const uint8_t* data, uint16_t len) override;
+    bool flush() override;
+    
+    const UDPBatchStats& get_batch_stats() const { return m_stats; }
+    
+protected:
+    void handle_events(uint32_t events) override;
     
 private:
     std::string m_host;
     uint16_t m_port;
     int m_socket;
     bool m_connected;
+    
+    // Preallocated recvmmsg/sendmmsg state
+    struct mmsghdr m_rx_msgs[UDP_BATCH_SIZE];
+    struct iovec m_rx_iovs[UDP_BATCH_SIZE];
+    uint8_t m_rx_buffers[UDP_BATCH_SIZE][UDP_MAX_DATAGRAM];
+    Datagram m_rx_datagrams[UDP_BATCH_SIZE];
+    
+    struct mmsghdr m_tx_msgs[UDP_BATCH_SIZE];
+    struct iovec m_tx_iovs[UDP_BATCH_SIZE];
+    uint8_t m_tx_buffers[UDP_BATCH_SIZE][UDP_MAX_DATAGRAM];
+    unsigned m_tx_count;
+    
+    UDPBatchStats m_stats;
 };
 
 class SerialUSBConnection : public Connection {
@@ -72,6 +180,7 @@ public:
     bool is_connected() const override;
     bool send(const uint8_t* data, uint16_t len) override;
     bool receive(uint8_t* buffer, uint16_t buffer_size, uint16_t& received_len) override;
+    int get_fd() const override { return m_serial_fd; }
     
 private:
     std::string m_port;
@@ -93,10 +202,18 @@ public:
     bool connect();
     void disconnect();
     bool is_connected() const;
+    bool is_connecting() const;
+    bool attach(EventLoop& loop, Connection::ReceiveHandler handler);
+    void detach();
     bool send(const uint8_t* data, uint16_t len);
+    bool queue_send(const uint8_t* data, uint16_t len);
+    bool flush();
     bool receive(uint8_t* buffer, uint16_t buffer_size, uint16_t& received_len);
     const std::string& get_error() const;
     
+    // Batch statistics of the active UDP connection, or nullptr for other types
+    const UDPBatchStats* get_udp_stats() const;
+    
 private:
     Connection* m_connection;
     ConnectionType m_type;
@@ -3,7 +3,7 @@
 
 ControlSender::ControlSender() : m_motor_test_mode(false) {
     memset(&m_packet, 0, sizeof(m_packet));
-    m_packet.packet_type = 1;  // Control packet type
+    m_packet.packet_type = PACKET_TYPE_CONTROL;
 }
 
 ControlSender::~ControlSender() {
@@ -44,23 +44,17 @@ void ControlSender::set_flight_mode(uint8_t mode) {
     m_packet.flight_mode = mode;
 }
 
-uint8_t ControlSender::calculate_checksum(const uint8_t* data, uint16_t len) const {
-    uint8_t checksum = 0;
-    for (uint16_t i = 0; i < len; i++) {
-        checksum ^= data[i];
+uint16_t ControlSender::serialize_into(uint8_t* out, uint16_t capacity) const {
+    if (capacity < CONTROL_PACKET_SIZE) {
+        return 0;
     }
-    return checksum;
+    
+    // ControlPacket is packed, so this is a block copy plus the CRC-16
+    return encode_control_packet(m_packet, out);
 }
 
 std::vector<uint8_t> ControlSender::serialize() const {
-    std::vector<uint8_t> buffer(sizeof(ControlPacket));
-    uint8_t* data = buffer.data();
-    
-    // Copy packet data
-    memcpy(data, &m_packet, sizeof(ControlPacket) - 1);  // Don't copy checksum yet
-    
-    // Calculate and set checksum
-    data[sizeof(ControlPacket) - 1] = calculate_checksum(data, sizeof(ControlPacket) - 1);
-    
+    std::vector<uint8_t> buffer(CONTROL_PACKET_SIZE);
+    serialize_into(buffer.data(), buffer.size());
     return buffer;
 }
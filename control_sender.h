@@ -1,26 +1,10 @@
 #pragma once
 
 #include "input.h"
+#include "rov_protocol.h"
 #include <cstdint>
 #include <vector>
 
-// Mirror of firmware MotorCommand for PC side
-struct MotorCommand {
-    uint8_t motor_id;
-    float throttle;
-    uint8_t enabled;
-};
-
-// Mirror of firmware ControlPacket for PC side
-struct ControlPacket {
-    uint8_t packet_type;
-    uint8_t motor_count;
-    MotorCommand motors[8];
-    uint8_t armed;
-    uint8_t flight_mode;
-    uint8_t checksum;
-};
-
 class ControlSender {
 public:
     ControlSender();
@@ -41,11 +25,26 @@ public:
     // Get the packet to send
     const ControlPacket& get_packet() const { return m_packet; }
     
-    // Serialize to bytes for transmission
+    // Stamp the link sequence number and send time (done by the transport at send time)
+    void set_sequence(uint16_t sequence, uint32_t timestamp_ms) {
+        m_packet.sequence = sequence;
+        m_packet.timestamp_ms = timestamp_ms;
+    }
+    
+    // ControlFlags requests for the firmware (set by the transport per send)
+    void set_flags(uint8_t flags) { m_packet.flags = flags; }
+    
+    // Replace the packet wholesale (e.g. with a snapshot queued by the UI thread)
+    void set_packet(const ControlPacket& packet) { m_packet = packet; }
+    
+    // Serialize into a caller-owned buffer without allocating.
+    // Returns the number of bytes written, or 0 if capacity < CONTROL_PACKET_SIZE.
+    uint16_t serialize_into(uint8_t* out, uint16_t capacity) const;
+    
+    // Serialize to bytes for transmission (allocates - prefer serialize_into on hot paths)
     std::vector<uint8_t> serialize() const;
     
 private:
     ControlPacket m_packet;
     bool m_motor_test_mode;
-    uint8_t calculate_checksum(const uint8_t* data, uint16_t len) const;
 };
@@ -0,0 +1,65 @@
+// Micro-benchmark: CRC variants from rov_crc.h against the old 8-bit XOR checksum.
+// Build and run with: make crc_bench && ./crc_bench
+#include "rov_crc.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static uint8_t xor_checksum(const uint8_t* data, size_t len) {
+    uint8_t checksum = 0;
+    for (size_t i = 0; i < len; i++) {
+        checksum ^= data[i];
+    }
+    return checksum;
+}
+
+template <typename F>
+static void run(const char* name, const std::vector<uint8_t>& buffer, size_t block, F fn) {
+    typedef std::chrono::steady_clock Clock;
+    const size_t total = 256u * 1024u * 1024u;
+    const size_t iterations = total / block;
+
+    volatile uint32_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        const uint8_t* data = buffer.data() + (i * block) % (buffer.size() - block);
+        sink = sink + fn(data, block);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::printf("  %-16s %9.1f MB/s  %7.1f ns/packet\n", name,
+                (double)(iterations * block) / seconds / 1e6, seconds * 1e9 / (double)iterations);
+}
+
+int main() {
+    const uint8_t* check = (const uint8_t*)"123456789";
+    if (crc16(check, 9) != 0x6F91 || crc32(check, 9) != 0xCBF43926u) {
+        std::fprintf(stderr, "CRC check values do not match\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> buffer(1 << 20);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = (uint8_t)std::rand();
+    }
+
+    const size_t blocks[] = {54, 145, 4096};
+    for (size_t block : blocks) {
+        std::printf("%zu-byte blocks:\n", block);
+        run("xor8", buffer, block, [](const uint8_t* d, size_t n) { return (uint32_t)xor_checksum(d, n); });
+        run("crc16 nibble", buffer, block, [](const uint8_t* d, size_t n) {
+            return (uint32_t)crc_update_nibble(CRC16_NIBBLE, CRC16_INIT, d, n); });
+        run("crc16 bytewise", buffer, block, [](const uint8_t* d, size_t n) {
+            return (uint32_t)crc_update_bytewise(CRC16_TABLES, CRC16_INIT, d, n); });
+        run("crc16 slice8", buffer, block, [](const uint8_t* d, size_t n) {
+            return (uint32_t)crc_update_slice8(CRC16_TABLES, CRC16_INIT, d, n); });
+        run("crc32 nibble", buffer, block, [](const uint8_t* d, size_t n) {
+            return crc_update_nibble(CRC32_NIBBLE, CRC32_INIT, d, n); });
+        run("crc32 bytewise", buffer, block, [](const uint8_t* d, size_t n) {
+            return crc_update_bytewise(CRC32_TABLES, CRC32_INIT, d, n); });
+        run("crc32 slice8", buffer, block, [](const uint8_t* d, size_t n) {
+            return crc_update_slice8(CRC32_TABLES, CRC32_INIT, d, n); });
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#define MAX_MOTORS 8
+#define MAX_FRAMES 10
+#define MAX_MOTOR_CONFIGS 5
+
+enum FrameType {
+    FRAME_VECTORED = 0,
+    FRAME_QUADCOPTER = 1,
+    FRAME_HEXACOPTER = 2,
+    FRAME_OCTOCOPTER = 3,
+    FRAME_CUSTOM = 4
+};
+
+// Thruster geometry in the body frame (NED: x forward, y right, z down)
+struct MotorConfig {
+    uint8_t motor_id;
+    float position[3];       // m from the centre of mass
+    float direction[3];      // unit thrust direction for a positive command
+    float reaction_torque;   // propeller drag torque along direction per unit thrust, m; sign = handedness
+    uint8_t reversed;        // ESC/propeller wired backwards: command is mirrored about neutral
+    float thrust_factor;     // relative maximum thrust
+};
+
+struct FrameConfig {
+    FrameType frame_type;
+    uint8_t num_motors;
+    MotorConfig motors[MAX_MOTORS];
+    const char* name;
+};
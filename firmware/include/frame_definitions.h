@@ -0,0 +1,157 @@
+#pragma once
+
+#include "frame_config.h"
+#include "thrust_allocator.h"
+#include "hardware_hal.h"
+#include <cstdint>
+
+// Q14 coefficients (the allocator normalizes every axis to |c| <= 1) times
+// Q14 commands (saturated at +/-1) give Q28 products; three of them stay
+// below 2^31.
+static constexpr int MIX_SHIFT = 14;
+static constexpr int MIX_OUTPUT_SHIFT = 2 * MIX_SHIFT;
+static constexpr int32_t MIX_ONE = 1 << MIX_OUTPUT_SHIFT;
+
+// Bidirectional ESCs: the neutral pulse stops the thruster, neutral -/+ the
+// half span is full reverse/forward. Disarmed and disabled outputs sit at neutral.
+static constexpr uint16_t ESC_NEUTRAL_US = 1500;
+static constexpr uint16_t ESC_HALF_SPAN_US = 400;
+
+constexpr int16_t mix_to_q14(float v) {
+    float c = v > 1.0f ? 1.0f : v < -1.0f ? -1.0f : v;
+    float q = c * (float)(1 << MIX_SHIFT);
+    return (int16_t)(q < 0.0f ? q - 0.5f : q + 0.5f);
+}
+
+constexpr uint32_t mix_pack_q14x2(int16_t lo, int16_t hi) {
+    return (uint32_t)(uint16_t)lo | ((uint32_t)(uint16_t)hi << 16);
+}
+
+// Fixed-point form of a frame's mix for MotorConfigManager::mix_to_ccr().
+// Each motor's row holds Q14 coefficients packed two per word so one SMLAD
+// applies two axes: (surge, sway), (heave, 0), (roll, pitch), (yaw, 0).
+// Products are Q28. Reversal and thrust factor are not folded in; MotorConfigManager
+// applies them as a per-motor row gain.
+struct MotorMixFixed {
+    uint32_t rows[MAX_MOTORS][4];
+    uint16_t ccr_neutral;     // timer compare value at zero thrust
+    uint16_t ccr_half_span;   // compare counts from zero to full thrust
+};
+
+// A frame with everything the mixer needs precomputed. All instances are
+// constexpr and live in flash; switching frames swaps a pointer.
+struct FrameDefinition {
+    FrameConfig config;
+    FrameMix mix;
+    MotorMixFixed fixed;
+    uint8_t reversed_mask;    // default reversal, bit per motor
+    uint8_t expected_axes;    // axes the geometry is meant to actuate, bit per WrenchAxis
+};
+
+// Nullptr for FRAME_CUSTOM or unknown types
+const FrameDefinition* find_frame_definition(FrameType type);
+
+// ============== Compile-time builders ==============
+
+constexpr float FRAME_PI = 3.14159265358979f;
+
+// Taylor series after reduction to [-pi/2, pi/2]; accurate to float precision
+constexpr float frame_sin(float radians) {
+    double x = radians;
+    while (x > FRAME_PI) x -= 2.0 * FRAME_PI;
+    while (x < -FRAME_PI) x += 2.0 * FRAME_PI;
+    if (x > FRAME_PI / 2.0) x = FRAME_PI - x;
+    if (x < -FRAME_PI / 2.0) x = -FRAME_PI - x;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return (float)sum;
+}
+
+constexpr float frame_cos(float radians) {
+    return frame_sin(radians + FRAME_PI / 2.0f);
+}
+
+constexpr MotorConfig frame_motor(uint8_t id, float x, float y, float z, float dx, float dy, float dz,
+                                  float reaction_torque, uint8_t reversed) {
+    return MotorConfig{id, {x, y, z}, {dx, dy, dz}, reaction_torque, reversed, 1.0f};
+}
+
+// Vertical thrusters evenly spaced on a ring, thrusting up (-z). Alternate
+// propeller handedness provides yaw through reaction torque. Reversal
+// alternates starting with first_reversed.
+constexpr FrameConfig frame_ring(FrameType type, const char* name, uint8_t count, float first_angle_deg,
+                                 uint8_t first_reversed) {
+    FrameConfig frame = {};
+    frame.frame_type = type;
+    frame.num_motors = count;
+    frame.name = name;
+    const float radius = 0.25f;
+    const float drag_torque = 0.05f;
+    for (uint8_t i = 0; i < count && i < MAX_MOTORS; i++) {
+        float angle = (first_angle_deg + 360.0f * i / count) * FRAME_PI / 180.0f;
+        frame.motors[i] = frame_motor(i, radius * frame_cos(angle), radius * frame_sin(angle), 0.0f,
+                                      0.0f, 0.0f, -1.0f, (i % 2 == 0) ? drag_torque : -drag_torque,
+                                      (uint8_t)((i + first_reversed) % 2));
+    }
+    return frame;
+}
+
+constexpr FrameDefinition frame_definition(const FrameConfig& config, uint8_t expected_axes) {
+    FrameDefinition def = {};
+    def.config = config;
+    def.mix = compute_frame_mix(config);
+    def.expected_axes = expected_axes;
+    for (uint8_t i = 0; i < config.num_motors && i < MAX_MOTORS; i++) {
+        const float* m = def.mix.mix[i];
+        def.fixed.rows[i][0] = mix_pack_q14x2(mix_to_q14(m[AXIS_SURGE]), mix_to_q14(m[AXIS_SWAY]));
+        def.fixed.rows[i][1] = mix_pack_q14x2(mix_to_q14(m[AXIS_HEAVE]), 0);
+        def.fixed.rows[i][2] = mix_pack_q14x2(mix_to_q14(m[AXIS_ROLL]), mix_to_q14(m[AXIS_PITCH]));
+        def.fixed.rows[i][3] = mix_pack_q14x2(mix_to_q14(m[AXIS_YAW]), 0);
+        if (config.motors[i].reversed) def.reversed_mask |= (uint8_t)(1u << i);
+    }
+    uint16_t ccr_min = PWMDriver::pulse_to_ccr(ESC_NEUTRAL_US - ESC_HALF_SPAN_US);
+    uint16_t ccr_max = PWMDriver::pulse_to_ccr(ESC_NEUTRAL_US + ESC_HALF_SPAN_US);
+    def.fixed.ccr_neutral = PWMDriver::pulse_to_ccr(ESC_NEUTRAL_US);
+    def.fixed.ccr_half_span = (uint16_t)((ccr_max - ccr_min) / 2);
+    return def;
+}
+
+// ============== Compile-time checks ==============
+
+constexpr bool frame_motor_count_valid(const FrameConfig& frame) {
+    return frame.num_motors > 0 && frame.num_motors <= MAX_MOTORS && frame.num_motors <= PWMDriver::CHANNELS;
+}
+
+// Motor ids in range and unique
+constexpr bool frame_motor_ids_valid(const FrameConfig& frame) {
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < frame.num_motors && i < MAX_MOTORS; i++) {
+        uint8_t id = frame.motors[i].motor_id;
+        if (id >= MAX_MOTORS || (seen & (1u << id))) return false;
+        seen |= 1u << id;
+    }
+    return true;
+}
+
+constexpr bool frame_directions_unit(const FrameConfig& frame) {
+    for (uint8_t i = 0; i < frame.num_motors && i < MAX_MOTORS; i++) {
+        const float* d = frame.motors[i].direction;
+        if (frame_abs(d[0] * d[0] + d[1] * d[1] + d[2] * d[2] - 1.0f) > 1e-4f) return false;
+    }
+    return true;
+}
+
+constexpr int frame_axis_count(uint8_t axes) {
+    int count = 0;
+    for (int j = 0; j < AXIS_COUNT; j++) count += (axes >> j) & 1;
+    return count;
+}
+
+// Rank matches the axes the frame is meant to control, and exactly those are reachable
+constexpr bool frame_rank_valid(const FrameDefinition& def) {
+    return def.mix.rank == frame_axis_count(def.expected_axes) && def.mix.controllable == def.expected_axes;
+}
@@ -11,12 +11,36 @@ public:
     void set_pwm(uint8_t channel, uint16_t pulse_us);
     void set_all_pwm(uint16_t pulse_us);
     
+    // Write precomputed compare values for all CHANNELS, skipping the per-call
+    // clamp and conversion; see pulse_to_ccr()
+    void write_ccr(const uint16_t* ccr);
+    
+    // Timer compare value for a pulse width, clamped to the ESC range.
+    // constexpr so mixing tables can be built at compile time.
+    static constexpr uint16_t pulse_to_ccr(uint16_t pulse_us) {
+        return (uint16_t)(((pulse_us < MIN_PULSE_US ? MIN_PULSE_US : pulse_us > MAX_PULSE_US ? MAX_PULSE_US : pulse_us) * 100) / 125);
+    }
+    
+    static const uint8_t CHANNELS = 8;
+    
 private:
     static const uint16_t PWM_FREQ_HZ = 400;
     static const uint16_t MIN_PULSE_US = 1000;
     static const uint16_t MAX_PULSE_US = 2000;
 };
 
+// Error and drop counters, updated from the USART1 interrupt
+struct UARTStats {
+    uint32_t rx_dropped;   // RX ring full
+    uint32_t rx_overruns;  // hardware ORE: a byte arrived before the ISR ran
+    uint32_t rx_errors;    // framing, noise or parity error
+    uint32_t tx_dropped;   // TX ring full
+};
+
+// USART1 driven by RXNE/TXE interrupts into single-producer/single-consumer
+// ring buffers. The ISR owns rx_head and tx_tail, the main loop owns rx_tail
+// and tx_head, so no locking is needed. write_bytes() queues and returns;
+// bytes that don't fit are dropped and counted.
 class UARTDriver {
 public:
     UARTDriver();
@@ -24,18 +48,76 @@ public:
     
     bool init(uint32_t baudrate = 57600);
     void write_byte(uint8_t byte);
-    void write_bytes(const uint8_t* data, uint16_t len);
-    uint8_t read_byte();
-    uint16_t read_available();
+    uint16_t write_bytes(const uint8_t* data, uint16_t len);  // returns bytes queued
+    uint8_t read_byte();                                       // 0 if nothing is buffered
+    uint16_t read_bytes(uint8_t* out, uint16_t max_len);
+    uint16_t read_available() const;
+    uint16_t write_free() const;
+    
+    void on_interrupt();  // called from USART1_IRQHandler only
+    UARTStats get_stats() const;
     
     void set_simulation_mode(bool sim) { simulation_mode = sim; }
     
+    // Powers of two so the free-running 16-bit indices wrap cleanly
+    static const uint16_t RX_BUFFER_SIZE = 512;
+    static const uint16_t TX_BUFFER_SIZE = 512;
+    
 private:
-    uint8_t rx_buffer[512];
-    uint16_t rx_head = 0;
-    uint16_t rx_tail = 0;
+    uint8_t rx_buffer[RX_BUFFER_SIZE];
+    volatile uint16_t rx_head = 0;
+    volatile uint16_t rx_tail = 0;
+    uint8_t tx_buffer[TX_BUFFER_SIZE];
+    volatile uint16_t tx_head = 0;
+    volatile uint16_t tx_tail = 0;
+    volatile uint32_t rx_dropped = 0;
+    volatile uint32_t rx_overruns = 0;
+    volatile uint32_t rx_errors = 0;
+    uint32_t tx_dropped = 0;
     bool simulation_mode = true;  // Default to simulation for safety
 };
 
+// Millisecond timebase driven by a 1kHz SysTick interrupt, plus the DWT cycle
+// counter for sub-microsecond execution timing. CYCCNT wraps every ~25s at
+// 168MHz, so cycle differences are only valid over shorter intervals.
+class SystemClock {
+public:
+    SystemClock();
+    ~SystemClock();
+    
+    bool init();
+    uint32_t millis() const { return ticks_ms; }
+    uint32_t micros() const;
+    uint32_t cycles() const;
+    
+    void on_tick() { ticks_ms = ticks_ms + 1; }  // called from SysTick_Handler only
+    
+    static const uint32_t CYCLES_PER_US = 168;
+    
+private:
+    volatile uint32_t ticks_ms = 0;
+};
+
+// Internal flash programming for the parameter store. Sector numbers are the
+// STM32F4 bank 1 layout. Both calls block until the controller is done; while
+// an erase runs, instruction fetches from flash stall, so a 128KB sector
+// freezes the core for one to two seconds.
+class FlashDriver {
+public:
+    // Memory-mapped address of a sector, for reads
+    static const uint8_t* sector_address(uint8_t sector);
+    static uint32_t sector_size(uint8_t sector);
+    
+    bool erase_sector(uint8_t sector);
+    
+    // Program count words at dst, which must be word aligned and erased
+    bool program(const void* dst, const uint32_t* words, uint16_t count);
+    
+private:
+    bool wait_ready();
+};
+
 extern PWMDriver g_pwm;
 extern UARTDriver g_uart;
+extern SystemClock g_clock;
+extern FlashDriver g_flash;
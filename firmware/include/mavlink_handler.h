@@ -1,74 +1,17 @@
 #pragma once
 
+#include "rov_protocol.h"
 #include <cstdint>
 #include <cstring>
 
-struct MotorCommand {
-    uint8_t motor_id;
-    float throttle;
-    uint8_t enabled;
-};
-
-struct SensorData {
-    float gyro_x, gyro_y, gyro_z;
-    float accel_x, accel_y, accel_z;
-    float mag_x, mag_y, mag_z;
-    float depth;
-    float temperature;
-    float pressure;
-};
-
-struct BatteryData {
-    float voltage;
-    float current;
-    float capacity_mah;
-    uint8_t percentage;
-};
-
-struct CameraData {
-    uint8_t camera_type;
-    float servo_min_pwm;
-    float servo_max_pwm;
-    uint8_t gimbal_type;
-};
-
-struct WaterSensorData {
-    int32_t pressure_offset;
-    float temp_offset;
-    uint8_t salinity_type;
-};
-
-struct PIDTuning {
-    float roll_p, roll_i, roll_d;
-    float pitch_p, pitch_i, pitch_d;
-    float yaw_p, yaw_i, yaw_d;
-    float depth_p, depth_i, depth_d;
-};
-
-struct RobotState {
-    uint8_t armed;
-    uint8_t flight_mode;
-    SensorData sensors;
-    BatteryData battery;
-    CameraData camera;
-    WaterSensorData water;
-    PIDTuning pid_tuning;
-    float roll, pitch, yaw;
-};
-
-struct ControlPacket {
-    uint8_t packet_type;
-    uint8_t motor_count;
-    MotorCommand motors[8];
-    uint8_t armed;
-    uint8_t flight_mode;
-    uint8_t checksum;
-};
+typedef void (*ControlPacketHandler)(const ControlPacket& control);
+typedef void (*ParamPacketHandler)(const ParamPacket& param);
 
-struct TelemetryPacket {
-    uint8_t packet_type;
-    RobotState state;
-    uint8_t checksum;
+struct ControlDecoderStats {
+    uint32_t packets;          // frames that passed the CRC, control and parameter
+    uint32_t framing_errors;   // candidate frames rejected by CRC
+    uint32_t bytes_discarded;  // bytes skipped while searching for a packet type byte
+    uint16_t packets_per_s;    // control packets accepted over the last RATE_WINDOW_MS
 };
 
 class ProtocolHandler {
@@ -77,10 +20,48 @@ public:
     ~ProtocolHandler();
     
     bool init();
-    void parse_control_packet(const uint8_t* data, uint16_t len);
+    
+    // Called for every accepted control packet
+    void set_control_handler(ControlPacketHandler handler) { control_handler = handler; }
+    
+    // Called for every accepted parameter request
+    void set_param_handler(ParamPacketHandler handler) { param_handler = handler; }
+    
+    // Streaming decoder for the GUI byte stream, which carries control and
+    // parameter packets. Bytes may arrive split or coalesced arbitrarily. A
+    // packet type byte marks a candidate frame, its type fixes the length,
+    // and the CRC-16 confirms it. On a CRC mismatch the decoder slides to the
+    // next type byte inside the rejected frame, so one lost or extra byte
+    // costs at most the packets it overlaps.
+    // Returns the number of packets of either type accepted from data.
+    uint16_t parse_control_packet(const uint8_t* data, uint16_t len);
+    
+    // Roll the packets-per-second window
+    void update_rates(uint32_t now_ms);
+    const ControlDecoderStats& get_control_stats() const { return control_stats; }
+    
+    // Record an accepted control packet so telemetry can echo its sequence
+    void note_control_received(const ControlPacket& control);
+    
+    // Stamps sequence, timestamp and control echo
     TelemetryPacket create_telemetry_packet(const RobotState& state);
-    uint8_t calculate_checksum(const uint8_t* data, uint16_t len);
+    
+    static const uint32_t RATE_WINDOW_MS = 1000;
     
 private:
-    uint8_t sequence_counter;
+    // Frame length for a packet type byte, 0 if the GUI never sends that type
+    static uint16_t frame_size(uint8_t type);
+    bool dispatch_frame();
+    void resync();
+    
+    uint16_t sequence_counter;
+    uint16_t last_control_sequence;
+    
+    ControlPacketHandler control_handler;
+    ParamPacketHandler param_handler;
+    uint8_t rx_frame[CONTROL_PACKET_SIZE > PARAM_PACKET_SIZE ? CONTROL_PACKET_SIZE : PARAM_PACKET_SIZE];
+    uint16_t rx_len;
+    ControlDecoderStats control_stats;
+    uint32_t window_start_ms;
+    uint32_t window_packets;
 };
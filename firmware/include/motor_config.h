@@ -1,39 +1,14 @@
 #pragma once
 
+#include "frame_definitions.h"
 #include <cstdint>
-#include <cstring>
 
-#define MAX_MOTORS 8
-#define MAX_FRAMES 10
-#define MAX_MOTOR_CONFIGS 5
-
-enum FrameType {
-    FRAME_VECTORED = 0,
-    FRAME_QUADCOPTER = 1,
-    FRAME_HEXACOPTER = 2,
-    FRAME_OCTOCOPTER = 3,
-    FRAME_CUSTOM = 4
-};
-
-struct MotorConfig {
-    uint8_t motor_id;
-    float angle_deg;
-    uint8_t reversed;
-    float thrust_factor;
-};
-
-struct FrameConfig {
-    FrameType frame_type;
-    uint8_t num_motors;
-    MotorConfig motors[MAX_MOTORS];
-    char name[32];
-};
-
-struct MotorMixing {
-    float roll_mix[MAX_MOTORS];
-    float pitch_mix[MAX_MOTORS];
-    float yaw_mix[MAX_MOTORS];
-    float throttle_mix[MAX_MOTORS];
+// Per-vehicle motor settings, kept in the parameter store
+struct MotorParams {
+    uint8_t frame_type;      // FrameType
+    uint8_t reversed_mask;   // bit per motor
+    uint8_t reserved[2];
+    float thrust_factor[MAX_MOTORS];
 };
 
 class MotorConfigManager {
@@ -42,28 +17,56 @@ public:
     ~MotorConfigManager();
     
     bool init();
+    
+    // Switch to a built-in frame; its tables are precomputed in flash, so this
+    // is a pointer swap. Resets motor reversal to the frame's default.
+    // Returns false for FRAME_CUSTOM.
     bool set_frame(FrameType frame);
-    bool load_config(const char* config_file);
-    bool save_config(const char* config_file);
     
-    void calculate_motor_commands(float roll, float pitch, float yaw, float throttle,
-                                   float* motor_outputs);
+    // Apply stored settings: frame first, then reversal and thrust factors.
+    // Returns false, changing nothing, if the frame is unknown.
+    bool load_config(const MotorParams& params);
+    void save_config(MotorParams& params) const;
+    
+    // Reference float path: ThrustAllocator then per-motor outputs in [0, 1],
+    // 0.5 being neutral. wrench has AXIS_COUNT commands in [-1, 1].
+    void calculate_motor_commands(const float* wrench, float* motor_outputs) const;
+    
+    // Fixed-point equivalent with the same prioritized saturation, done with
+    // integer multiplies and one divide per stage, fused with reversal, thrust
+    // factor and PWM scaling into one pass. Writes a timer
+    // compare value for every PWMDriver channel; channels past the frame's
+    // motor count get ESC_NEUTRAL_US. Commands saturate at +/-1.
+    void mix_to_ccr(const float* wrench, uint16_t* ccr) const;
     
     void set_motor_reversed(uint8_t motor_id, uint8_t reversed);
     uint8_t get_motor_reversed(uint8_t motor_id) const;
+    void set_reversed_mask(uint8_t mask);
+    uint8_t get_reversed_mask() const { return reversed_mask; }
+    
+    // Thruster output relative to nominal. The motor's mix row is divided by
+    // it ahead of saturation, so a weak thruster gets a larger command and
+    // the rest of the mix is scaled back when it reaches full scale.
+    // Returns false if factor is outside THRUST_FACTOR_MIN..MAX.
+    bool set_thrust_factor(uint8_t motor_id, float factor);
+    float get_thrust_factor(uint8_t motor_id) const;
     
-    const FrameConfig& get_current_frame() const { return current_frame; }
-    const MotorMixing& get_mixing_matrix() const { return mixing_matrix; }
+    FrameType get_frame_type() const { return frame->config.frame_type; }
+    const FrameConfig& get_current_frame() const { return frame->config; }
+    const ThrustAllocator& get_allocator() const { return allocator; }
     
-    static void build_vectored_frame(FrameConfig& frame);
-    static void build_quadcopter_frame(FrameConfig& frame);
-    static void build_hexacopter_frame(FrameConfig& frame);
-    static void build_octocopter_frame(FrameConfig& frame);
+    static constexpr float THRUST_FACTOR_MIN = 0.5f;
+    static constexpr float THRUST_FACTOR_MAX = 2.0f;
     
 private:
-    FrameConfig current_frame;
-    MotorMixing mixing_matrix;
+    void update_row_gains();
     
-    void recalculate_mixing_matrix();
+    const FrameDefinition* frame;
+    ThrustAllocator allocator;
+    uint8_t reversed_mask;  // bit per motor
+    float thrust_factor[MAX_MOTORS];
+    // Applied to each mix row before saturation: sign is reversal, magnitude 1 / thrust_factor
+    float row_gain[MAX_MOTORS];
+    int16_t row_gain_q13[MAX_MOTORS];
 };
 
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "motor_config.h"
+#include "rov_protocol.h"
+#include <cstdint>
+
+// Everything that survives a reboot
+struct StoredParams {
+    MotorParams motors;
+    PIDTuning pid;
+};
+
+// Log-structured parameter storage in two flash sectors (see linker.ld).
+// Every save appends a complete StoredParams snapshot as one CRC-protected
+// record in the next free slot of the active sector, so each slot is written
+// once per erase and wear spreads over the whole sector. When the sector is
+// full the next record starts the other one, which is erased first; the old
+// sector stays readable until then. Records carry an increasing sequence
+// number, and the one with the highest sequence and a valid CRC wins.
+//
+// Invariant: within a sector, every slot before the first empty one (sequence
+// word still 0xFFFFFFFF) has been written, and none after it. load() relies on
+// this to find the end of each sector's log with a binary search over "slot
+// written". It then checks records backwards from there until one passes its
+// CRC, normally the first unless power was lost mid-write. Boot reads a few
+// dozen words, not the log. save() keeps the invariant when programming
+// fails: the failed slot gets a non-empty sequence word, or, if even that
+// can't be programmed, the sector is abandoned for the next save.
+class ParamStore {
+public:
+    ParamStore();
+    
+    // Read the newest valid record into params. Returns false, leaving params
+    // untouched, if there is none or its layout doesn't match this build.
+    bool load(StoredParams& params);
+    
+    // Append params as a new record. Returns false if programming failed; the
+    // slot is then used up and the next save takes a fresh one.
+    bool save(const StoredParams& params);
+    
+    // The next save() has to erase a sector, stalling the core for 1-2 s
+    bool save_needs_erase() const;
+    
+    uint32_t get_sequence() const { return sequence; }
+    
+    static const uint8_t SECTORS[2];
+    
+private:
+    struct Record {
+        uint32_t sequence;  // never 0xFFFFFFFF, which reads as an empty slot
+        uint16_t length;    // sizeof(StoredParams) of the build that wrote it
+        uint16_t crc;       // CRC-16 of the whole record with this field zero
+        StoredParams params;
+    };
+    
+    static const uint32_t SECTOR_MAGIC = 0x31505652;  // "RVP1", first word of a formatted sector
+    static const uint32_t HEADER_SIZE = 4;
+    
+    static uint16_t record_crc(const Record& record);
+    static const Record* slot_record(uint8_t index, uint32_t slot);
+    static uint32_t slot_count(uint8_t index);
+    static bool slot_used(uint8_t index, uint32_t slot);
+    
+    // Binary search for the first unused slot
+    static uint32_t find_end(uint8_t index);
+    
+    // Newest valid record in a sector, or nullptr
+    static const Record* newest_record(uint8_t index, uint32_t end);
+    
+    int8_t active;       // index into SECTORS, -1 until a sector is in use
+    uint32_t next_slot;  // in the active sector
+    uint32_t sequence;   // of the newest record
+};
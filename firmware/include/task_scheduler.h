@@ -0,0 +1,55 @@
+#pragma once
+
+#include "rov_protocol.h"
+#include <cstdint>
+
+typedef void (*TaskFunction)(uint32_t now_ms);
+
+// One row of the task table
+struct TaskEntry {
+    const char* name;
+    TaskFunction run;
+    uint16_t period_ms;
+};
+
+// Fixed-rate cooperative scheduler for the firmware super-loop.
+// Tasks run to completion in table order whenever their period has elapsed on
+// the SysTick millisecond clock; between releases the core sleeps in WFI until
+// the next interrupt. Execution time is measured with the DWT cycle counter.
+// A task overruns when it is released a whole period late (a missed release
+// is skipped, not burst to catch up) or runs longer than its period.
+class TaskScheduler {
+public:
+    TaskScheduler();
+    
+    // tasks must outlive the scheduler; count is capped at TASK_COUNT
+    void init(const TaskEntry* tasks, uint8_t count, uint32_t now_ms);
+    
+    // Run every task that is due at now_ms. Returns the number run.
+    uint8_t run_pending(uint32_t now_ms);
+    
+    // run_pending() forever, sleeping between ticks
+    void run();
+    
+    // Per-task timing over the last complete TIMING_WINDOW_MS
+    const TaskTiming& get_timing() const { return timing; }
+    
+    static const uint32_t TIMING_WINDOW_MS = 1000;
+    
+private:
+    struct TaskState {
+        uint32_t next_ms;
+        uint32_t runs;       // in the current window
+        uint64_t total_us;   // in the current window
+        uint32_t max_us;     // in the current window
+        uint32_t overruns;   // since init
+    };
+    
+    void update_timing(uint32_t now_ms);
+    
+    const TaskEntry* table;
+    uint8_t task_count;
+    TaskState state[TASK_COUNT];
+    uint32_t window_start_ms;
+    TaskTiming timing;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "rov_protocol.h"
+#include <cstdint>
+
+// One row of the telemetry schedule
+struct TelemetryGroupSchedule {
+    uint8_t group;        // TelemetryDeltaGroup
+    uint16_t period_ms;   // 0 = only when changed or requested
+    uint8_t priority;     // 0 = packed first when the budget is short
+};
+
+// Table-driven multi-rate telemetry scheduler.
+// Each tick, poll() picks the delta groups that are due and packs them in
+// priority order into one frame, within a token-bucket byte budget refilled at
+// BUDGET_PERCENT of the UART line rate. Groups that don't fit stay due for the
+// next tick. Periodic groups whose quantized bytes haven't changed are skipped
+// until REFRESH_MS. Config groups go out when they change or on request.
+// Full keyframes go out at startup, on request and every KEYFRAME_INTERVAL_MS.
+class TelemetryScheduler {
+public:
+    TelemetryScheduler();
+    
+    void init(uint32_t baudrate);
+    
+    void request_keyframe() { keyframe_pending = true; }
+    void request_config();
+    
+    // Select what to send at now_ms. Returns true if a frame is due;
+    // the caller then stamps a TelemetryPacket and calls encode().
+    bool poll(const RobotState& state, uint32_t now_ms);
+    
+    // Encode the frame selected by the last poll(). Returns bytes written,
+    // or 0 if capacity is too small.
+    uint16_t encode(const TelemetryPacket& packet, uint8_t* out, uint16_t capacity);
+    
+    // Claim bytes from the budget for traffic sent outside telemetry frames,
+    // such as parameter replies. Returns false if the budget can't cover them
+    // yet; the caller retries on a later tick.
+    bool reserve(uint16_t bytes, uint32_t now_ms);
+    
+    const LinkUtilization& get_link_utilization() const { return link; }
+    
+    static const uint8_t BUDGET_PERCENT = 80;
+    static const uint32_t REFRESH_MS = 1000;
+    static const uint32_t KEYFRAME_INTERVAL_MS = 10000;
+    static const uint32_t KEYFRAME_MIN_INTERVAL_MS = 500;  // rate limit for repeated requests
+    static const uint32_t UTILIZATION_WINDOW_MS = 1000;
+    
+private:
+    static const TelemetryGroupSchedule SCHEDULE[DELTA_GROUP_COUNT];
+    static const uint8_t LOWEST_PRIORITY = 4;
+    
+    void refill_budget(uint32_t now_ms);
+    void update_utilization(uint32_t now_ms);
+    bool group_due(const TelemetryGroupSchedule& entry, uint32_t now_ms) const;
+    
+    uint8_t candidate[DELTA_GROUP_COUNT][DELTA_GROUP_MAX_SIZE];
+    uint8_t last_sent[DELTA_GROUP_COUNT][DELTA_GROUP_MAX_SIZE];
+    uint32_t last_sent_ms[DELTA_GROUP_COUNT];
+    uint16_t requested_groups;
+    uint16_t selected_groups;
+    float keyframe_capacity_mah;
+    
+    bool send_keyframe;
+    bool keyframe_pending;
+    uint32_t last_keyframe_ms;
+    
+    uint32_t bytes_per_second;  // budget refill rate
+    int32_t budget;             // may go negative after a keyframe
+    uint32_t budget_ms;
+    
+    uint32_t poll_ms;           // time of the last poll()
+    uint32_t window_start_ms;
+    uint32_t window_bytes;
+    uint32_t window_deferred;
+    LinkUtilization link;
+};
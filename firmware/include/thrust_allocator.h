@@ -0,0 +1,253 @@
+#pragma once
+
+#include "frame_config.h"
+#include <cstdint>
+
+// Body-frame wrench axes (NED: x forward, y right, z down)
+enum WrenchAxis {
+    AXIS_SURGE = 0,
+    AXIS_SWAY,
+    AXIS_HEAVE,
+    AXIS_ROLL,
+    AXIS_PITCH,
+    AXIS_YAW,
+    AXIS_COUNT
+};
+
+// Normalized pseudo-inverse of a frame's allocation matrix:
+// thrust[i] = sum_j mix[i][j] * wrench[j]
+struct FrameMix {
+    float mix[MAX_MOTORS][AXIS_COUNT];
+    uint8_t num_motors;
+    uint8_t rank;
+    uint8_t controllable;  // bit per WrenchAxis
+};
+
+// ============== Compile-time allocation math ==============
+// Everything below is constexpr so frame tables can be built by the compiler
+// (see frame_definitions.cpp). The same functions work at runtime.
+
+constexpr float frame_abs(float v) {
+    return v < 0.0f ? -v : v;
+}
+
+constexpr float frame_sqrt(float v) {
+    if (v <= 0.0f) return 0.0f;
+    double x = v > 1.0f ? (double)v : 1.0;
+    for (int i = 0; i < 40; i++) x = 0.5 * (x + (double)v / x);
+    return (float)x;
+}
+
+static constexpr int FRAME_GRAM_MAX = MAX_MOTORS > AXIS_COUNT ? MAX_MOTORS : AXIS_COUNT;
+
+struct FrameSquare {
+    float m[FRAME_GRAM_MAX][FRAME_GRAM_MAX];
+};
+
+struct FrameAllocation {
+    float b[AXIS_COUNT][MAX_MOTORS];
+};
+
+// Column i: force d and moment r x d plus the propeller's reaction torque
+constexpr FrameAllocation frame_allocation_matrix(const FrameConfig& frame) {
+    FrameAllocation out = {};
+    for (int i = 0; i < frame.num_motors && i < MAX_MOTORS; i++) {
+        const MotorConfig& motor = frame.motors[i];
+        const float* p = motor.position;
+        const float* d = motor.direction;
+        float k = motor.reaction_torque;
+        float f = motor.thrust_factor;
+        out.b[AXIS_SURGE][i] = f * d[0];
+        out.b[AXIS_SWAY][i]  = f * d[1];
+        out.b[AXIS_HEAVE][i] = f * d[2];
+        out.b[AXIS_ROLL][i]  = f * (p[1] * d[2] - p[2] * d[1] + k * d[0]);
+        out.b[AXIS_PITCH][i] = f * (p[2] * d[0] - p[0] * d[2] + k * d[1]);
+        out.b[AXIS_YAW][i]   = f * (p[0] * d[1] - p[1] * d[0] + k * d[2]);
+    }
+    return out;
+}
+
+// Invert the n x n symmetric positive definite matrix a (Gauss-Jordan with
+// partial pivoting). ok is cleared if a pivot vanishes.
+constexpr FrameSquare frame_invert(FrameSquare a, int n, bool& ok) {
+    FrameSquare inv = {};
+    for (int i = 0; i < n; i++) inv.m[i][i] = 1.0f;
+    ok = true;
+    
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int r = col + 1; r < n; r++) {
+            if (frame_abs(a.m[r][col]) > frame_abs(a.m[pivot][col])) pivot = r;
+        }
+        if (frame_abs(a.m[pivot][col]) < 1e-12f) {
+            ok = false;
+            return inv;
+        }
+        if (pivot != col) {
+            for (int c = 0; c < n; c++) {
+                float t = a.m[col][c]; a.m[col][c] = a.m[pivot][c]; a.m[pivot][c] = t;
+                t = inv.m[col][c]; inv.m[col][c] = inv.m[pivot][c]; inv.m[pivot][c] = t;
+            }
+        }
+        float scale = 1.0f / a.m[col][col];
+        for (int c = 0; c < n; c++) {
+            a.m[col][c] *= scale;
+            inv.m[col][c] *= scale;
+        }
+        for (int r = 0; r < n; r++) {
+            if (r == col) continue;
+            float f = a.m[r][col];
+            if (f == 0.0f) continue;
+            for (int c = 0; c < n; c++) {
+                a.m[r][c] -= f * a.m[col][c];
+                inv.m[r][c] -= f * inv.m[col][c];
+            }
+        }
+    }
+    return inv;
+}
+
+// Moore-Penrose pseudo-inverse of the 6 x n allocation matrix, using a
+// rank-revealing Cholesky factorization of the smaller Gram matrix (Courrieu,
+// "Fast computation of Moore-Penrose inverse matrices", 2005). Exact for
+// rank-deficient matrices, which is the normal case for frames without
+// lateral thrusters. Each axis column is then scaled so that a command of 1.0
+// on that axis alone drives the most loaded thruster to full thrust; axes the
+// frame can't actuate get an all-zero column.
+constexpr FrameMix compute_frame_mix(const FrameConfig& frame) {
+    FrameMix out = {};
+    const int m = AXIS_COUNT;
+    const int n = frame.num_motors < MAX_MOTORS ? frame.num_motors : MAX_MOTORS;
+    out.num_motors = (uint8_t)n;
+    if (n == 0) return out;
+    
+    FrameAllocation g = frame_allocation_matrix(frame);
+    
+    // Work on A = G^T G (n x n) when n <= m, otherwise A = G G^T (m x m)
+    const bool transpose = n > m;
+    const int k = transpose ? m : n;
+    FrameSquare a = {};
+    float max_diag = 0.0f;
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < k; j++) {
+            float sum = 0.0f;
+            if (transpose) {
+                for (int c = 0; c < n; c++) sum += g.b[i][c] * g.b[j][c];
+            } else {
+                for (int r = 0; r < m; r++) sum += g.b[r][i] * g.b[r][j];
+            }
+            a.m[i][j] = sum;
+        }
+        if (a.m[i][i] > max_diag) max_diag = a.m[i][i];
+    }
+    if (max_diag <= 0.0f) return out;
+    const float tolerance = max_diag * 1e-6f;
+    
+    // Full-rank factor L (k x r): A = L L^T, skipping dependent columns
+    FrameSquare l = {};
+    int r = 0;
+    for (int col = 0; col < k; col++) {
+        for (int i = col; i < k; i++) {
+            float sum = a.m[i][col];
+            for (int p = 0; p < r; p++) sum -= l.m[i][p] * l.m[col][p];
+            l.m[i][r] = sum;
+        }
+        if (l.m[col][r] > tolerance) {
+            float d = frame_sqrt(l.m[col][r]);
+            l.m[col][r] = d;
+            for (int i = col + 1; i < k; i++) l.m[i][r] /= d;
+            r++;
+        } else {
+            for (int i = col; i < k; i++) l.m[i][r] = 0.0f;
+        }
+    }
+    if (r == 0) return out;
+    
+    // M = (L^T L)^-1, r x r
+    FrameSquare ltl = {};
+    for (int i = 0; i < r; i++) {
+        for (int j = 0; j < r; j++) {
+            float sum = 0.0f;
+            for (int p = 0; p < k; p++) sum += l.m[p][i] * l.m[p][j];
+            ltl.m[i][j] = sum;
+        }
+    }
+    bool ok = false;
+    FrameSquare mm = frame_invert(ltl, r, ok);
+    if (!ok) return out;
+    
+    // W = (L M)(L M)^T, k x k
+    FrameSquare lm = {};
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < r; j++) {
+            float sum = 0.0f;
+            for (int p = 0; p < r; p++) sum += l.m[i][p] * mm.m[p][j];
+            lm.m[i][j] = sum;
+        }
+    }
+    FrameSquare w = {};
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < k; j++) {
+            float sum = 0.0f;
+            for (int p = 0; p < r; p++) sum += lm.m[i][p] * lm.m[j][p];
+            w.m[i][j] = sum;
+        }
+    }
+    
+    // Y = G^T W (transpose) or W G^T, n x m
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            float sum = 0.0f;
+            if (transpose) {
+                for (int p = 0; p < m; p++) sum += g.b[p][i] * w.m[p][j];
+            } else {
+                for (int p = 0; p < n; p++) sum += w.m[i][p] * g.b[j][p];
+            }
+            out.mix[i][j] = sum;
+        }
+    }
+    out.rank = (uint8_t)r;
+    
+    // Normalize each axis to its authority; drop numerical noise on axes the frame can't reach
+    for (int j = 0; j < m; j++) {
+        float peak = 0.0f;
+        float reach = 0.0f;  // (B B+) e_j: how much of the axis the frame can produce
+        for (int i = 0; i < n; i++) {
+            if (frame_abs(out.mix[i][j]) > peak) peak = frame_abs(out.mix[i][j]);
+            reach += g.b[j][i] * out.mix[i][j];
+        }
+        if (peak <= 0.0f || reach < 0.5f) {
+            for (int i = 0; i < n; i++) out.mix[i][j] = 0.0f;
+            continue;
+        }
+        for (int i = 0; i < n; i++) out.mix[i][j] /= peak;
+        out.controllable |= (uint8_t)(1u << j);
+    }
+    return out;
+}
+
+// ============== Runtime allocation ==============
+// Saturation is prioritized: the attitude part (roll, pitch, yaw) is applied
+// first, scaled down uniformly if it alone would saturate a thruster, and the
+// translation part (surge, sway, heave) is scaled into whatever headroom is
+// left. Directions are preserved on both instead of clipping motors one by one.
+class ThrustAllocator {
+public:
+    ThrustAllocator() : active(nullptr) {}
+    
+    // Point at a precomputed mix, normally one in flash; it must outlive the allocator
+    void configure(const FrameMix* mix) { active = mix; }
+    
+    // wrench: AXIS_COUNT commands in [-1, 1]. thrust: per-motor thrust in [-1, 1].
+    // row_gain, if given, scales each motor's mix row before saturation, so
+    // the limits still apply to what each thruster is actually asked for.
+    void allocate(const float* wrench, float* thrust, const float* row_gain = nullptr) const;
+    
+    uint8_t get_num_motors() const { return active ? active->num_motors : 0; }
+    uint8_t get_rank() const { return active ? active->rank : 0; }
+    bool is_controllable(WrenchAxis axis) const { return active && (active->controllable & (1u << axis)) != 0; }
+    const FrameMix* get_mix() const { return active; }
+    
+private:
+    const FrameMix* active;
+};
@@ -0,0 +1,59 @@
+#include "frame_definitions.h"
+
+static constexpr uint8_t AXES_ALL = (1u << AXIS_COUNT) - 1;
+static constexpr uint8_t AXES_VERTICAL = (1u << AXIS_HEAVE) | (1u << AXIS_ROLL) | (1u << AXIS_PITCH) | (1u << AXIS_YAW);
+
+// Four horizontal thrusters at the corners, angled 45 deg for surge, sway
+// and yaw; four vertical ones for heave, roll and pitch
+static constexpr float H = 0.70710678f;
+static constexpr FrameConfig VECTORED_CONFIG = {
+    FRAME_VECTORED, 8, {
+        frame_motor(0,  0.156f,  0.111f,  0.000f,  H, -H,  0.0f, 0.0f, 0),
+        frame_motor(1,  0.156f, -0.111f,  0.000f,  H,  H,  0.0f, 0.0f, 0),
+        frame_motor(2, -0.156f,  0.111f,  0.000f,  H,  H,  0.0f, 0.0f, 0),
+        frame_motor(3, -0.156f, -0.111f,  0.000f,  H, -H,  0.0f, 0.0f, 0),
+        frame_motor(4,  0.120f,  0.218f, -0.085f, 0.0f, 0.0f, -1.0f, 0.0f, 0),
+        frame_motor(5,  0.120f, -0.218f, -0.085f, 0.0f, 0.0f, -1.0f, 0.0f, 0),
+        frame_motor(6, -0.120f,  0.218f, -0.085f, 0.0f, 0.0f, -1.0f, 0.0f, 0),
+        frame_motor(7, -0.120f, -0.218f, -0.085f, 0.0f, 0.0f, -1.0f, 0.0f, 0),
+    },
+    "Vectored ROV (8x motor)"
+};
+
+static constexpr FrameConfig QUADCOPTER_CONFIG = frame_ring(FRAME_QUADCOPTER, "Quadcopter (4x motor X)", 4, 45.0f, 1);
+static constexpr FrameConfig HEXACOPTER_CONFIG = frame_ring(FRAME_HEXACOPTER, "Hexacopter (6x motor)", 6, 0.0f, 0);
+static constexpr FrameConfig OCTOCOPTER_CONFIG = frame_ring(FRAME_OCTOCOPTER, "Octocopter (8x motor)", 8, 22.5f, 0);
+
+static constexpr FrameDefinition VECTORED = frame_definition(VECTORED_CONFIG, AXES_ALL);
+static constexpr FrameDefinition QUADCOPTER = frame_definition(QUADCOPTER_CONFIG, AXES_VERTICAL);
+static constexpr FrameDefinition HEXACOPTER = frame_definition(HEXACOPTER_CONFIG, AXES_VERTICAL);
+static constexpr FrameDefinition OCTOCOPTER = frame_definition(OCTOCOPTER_CONFIG, AXES_VERTICAL);
+
+#define CHECK_FRAME(def) \
+    static_assert(frame_motor_count_valid(def.config), #def ": motor count out of range"); \
+    static_assert(frame_motor_ids_valid(def.config), #def ": duplicate or out of range motor id"); \
+    static_assert(frame_directions_unit(def.config), #def ": thrust direction is not a unit vector"); \
+    static_assert(frame_rank_valid(def), #def ": allocation rank doesn't match the expected axes")
+
+CHECK_FRAME(VECTORED);
+CHECK_FRAME(QUADCOPTER);
+CHECK_FRAME(HEXACOPTER);
+CHECK_FRAME(OCTOCOPTER);
+
+static_assert(VECTORED.fixed.ccr_half_span > 0, "fixed mix scaling not set");
+
+// Indexed by FrameType
+static const FrameDefinition* const FRAME_DEFINITIONS[] = {
+    &VECTORED,
+    &QUADCOPTER,
+    &HEXACOPTER,
+    &OCTOCOPTER,
+};
+static_assert(sizeof(FRAME_DEFINITIONS) / sizeof(FRAME_DEFINITIONS[0]) == FRAME_CUSTOM, "one definition per built-in frame type");
+
+const FrameDefinition* find_frame_definition(FrameType type) {
+    if ((unsigned)type >= sizeof(FRAME_DEFINITIONS) / sizeof(FRAME_DEFINITIONS[0])) {
+        return nullptr;
+    }
+    return FRAME_DEFINITIONS[type];
+}
@@ -33,9 +33,57 @@
 #define USART_BRR(base) (base + 0x08)
 #define USART_CR1(base) (base + 0x0C)
 #define USART_CR3(base) (base + 0x14)
+#define USART_SR_PE   (1 << 0)
+#define USART_SR_FE   (1 << 1)
+#define USART_SR_NE   (1 << 2)
+#define USART_SR_ORE  (1 << 3)
+#define USART_SR_RXNE (1 << 5)
+#define USART_SR_TXE  (1 << 7)
+#define USART_CR1_RXNEIE (1 << 5)
+#define USART_CR1_TXEIE  (1 << 7)
+
+#define NVIC_ISER1 0xE000E104
+#define USART1_IRQN 37
+
+// Orders ring buffer data accesses against the index update. A single-core
+// Cortex-M4 needs no hardware barrier, only one that stops the compiler.
+#define COMPILER_BARRIER() __asm__ volatile("" ::: "memory")
+
+#define SYSTEM_CLOCK_HZ 168000000
+#define DEMCR 0xE000EDFC
+#define DWT_CTRL 0xE0001000
+#define DWT_CYCCNT 0xE0001004
+#define SYST_CSR 0xE000E010
+#define SYST_RVR 0xE000E014
+#define SYST_CVR 0xE000E018
+#define SYST_CSR_ENABLE    (1 << 0)
+#define SYST_CSR_TICKINT   (1 << 1)
+#define SYST_CSR_CLKSOURCE (1 << 2)  // processor clock
+#define SCB_ICSR 0xE000ED04
+#define SCB_ICSR_PENDSTSET (1 << 26)  // SysTick exception pending
+
+#define FLASH_R_BASE 0x40023C00
+#define FLASH_ACR  (FLASH_R_BASE + 0x00)
+#define FLASH_KEYR (FLASH_R_BASE + 0x04)
+#define FLASH_SR   (FLASH_R_BASE + 0x0C)
+#define FLASH_CR   (FLASH_R_BASE + 0x10)
+#define FLASH_KEY1 0x45670123
+#define FLASH_KEY2 0xCDEF89AB
+#define FLASH_SR_BSY    (1 << 16)
+#define FLASH_SR_ERRORS ((1 << 7) | (1 << 6) | (1 << 5) | (1 << 4) | (1 << 1))  // PGSERR PGPERR PGAERR WRPERR OPERR
+#define FLASH_CR_PG        (1 << 0)
+#define FLASH_CR_SER       (1 << 1)
+#define FLASH_CR_SNB_SHIFT 3
+#define FLASH_CR_PSIZE_X32 (2 << 8)  // word parallelism, needs 2.7-3.6V
+#define FLASH_CR_STRT      (1 << 16)
+#define FLASH_CR_LOCK      (1u << 31)
+#define FLASH_ACR_DCEN  (1 << 10)
+#define FLASH_ACR_DCRST (1 << 12)
 
 PWMDriver g_pwm;
 UARTDriver g_uart;
+SystemClock g_clock;
+FlashDriver g_flash;
 
 PWMDriver::PWMDriver() {}
 PWMDriver::~PWMDriver() {}
@@ -80,24 +128,26 @@ bool PWMDriver::init() {
     return true;
 }
 
+// Channels 0-3 on TIM1, 4-7 on TIM3
+static volatile uint32_t* const PWM_CCR[PWMDriver::CHANNELS] = {
+    &HWREG(TIM_CCR1(TIM1_BASE)), &HWREG(TIM_CCR2(TIM1_BASE)), &HWREG(TIM_CCR3(TIM1_BASE)), &HWREG(TIM_CCR4(TIM1_BASE)),
+    &HWREG(TIM_CCR1(TIM3_BASE)), &HWREG(TIM_CCR2(TIM3_BASE)), &HWREG(TIM_CCR3(TIM3_BASE)), &HWREG(TIM_CCR4(TIM3_BASE)),
+};
+
 void PWMDriver::set_pwm(uint8_t channel, uint16_t pulse_us) {
-    if (pulse_us < MIN_PULSE_US) pulse_us = MIN_PULSE_US;
-    if (pulse_us > MAX_PULSE_US) pulse_us = MAX_PULSE_US;
-    
-    uint32_t ccr_value = (pulse_us * 100) / 125;
-    
-    if (channel == 0) HWREG(TIM_CCR1(TIM1_BASE)) = ccr_value;
-    else if (channel == 1) HWREG(TIM_CCR2(TIM1_BASE)) = ccr_value;
-    else if (channel == 2) HWREG(TIM_CCR3(TIM1_BASE)) = ccr_value;
-    else if (channel == 3) HWREG(TIM_CCR4(TIM1_BASE)) = ccr_value;
-    else if (channel == 4) HWREG(TIM_CCR1(TIM3_BASE)) = ccr_value;
-    else if (channel == 5) HWREG(TIM_CCR2(TIM3_BASE)) = ccr_value;
-    else if (channel == 6) HWREG(TIM_CCR3(TIM3_BASE)) = ccr_value;
-    else if (channel == 7) HWREG(TIM_CCR4(TIM3_BASE)) = ccr_value;
+    if (channel < CHANNELS) {
+        *PWM_CCR[channel] = pulse_to_ccr(pulse_us);
+    }
+}
+
+void PWMDriver::write_ccr(const uint16_t* ccr) {
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        *PWM_CCR[i] = ccr[i];
+    }
 }
 
 void PWMDriver::set_all_pwm(uint16_t pulse_us) {
-    for (uint8_t i = 0; i < 8; i++) {
+    for (uint8_t i = 0; i < CHANNELS; i++) {
         set_pwm(i, pulse_us);
     }
 }
@@ -106,43 +156,231 @@ UARTDriver::UARTDriver() {}
 UARTDriver::~UARTDriver() {}
 
 bool UARTDriver::init(uint32_t baudrate) {
+    rx_head = rx_tail = 0;
+    tx_head = tx_tail = 0;
+    rx_dropped = rx_overruns = rx_errors = 0;
+    tx_dropped = 0;
+    
     HWREG(RCC_AHB1ENR) |= (1 << 0);
     HWREG(RCC_APB2ENR) |= (1 << 4);
     
     uint32_t brr = 168000000 / (16 * baudrate);
     HWREG(USART_BRR(USART1_BASE)) = brr;
-    HWREG(USART_CR1(USART1_BASE)) = 0x200C;
+    HWREG(USART_CR1(USART1_BASE)) = 0x200C | USART_CR1_RXNEIE;  // UE, TE, RE; TXEIE is set when data is queued
     HWREG(USART_CR3(USART1_BASE)) = 0x0000;
     
     HWREG(GPIO_MODER(GPIOA_BASE)) |= 0x00A00000;
     HWREG(GPIO_AFRH(GPIOA_BASE)) |= 0x00000770;
     
+    HWREG(NVIC_ISER1) = 1u << (USART1_IRQN - 32);
+    
     return true;
 }
 
+void UARTDriver::on_interrupt() {
+    uint32_t sr = HWREG(USART_SR(USART1_BASE));
+    
+    // Reading DR after SR also clears ORE, FE, NE and PE
+    if (sr & (USART_SR_RXNE | USART_SR_ORE)) {
+        uint8_t byte = (uint8_t)HWREG(USART_DR(USART1_BASE));
+        if (sr & USART_SR_ORE) rx_overruns++;
+        if (sr & (USART_SR_FE | USART_SR_NE | USART_SR_PE)) {
+            rx_errors++;
+        } else {
+            uint16_t head = rx_head;
+            if ((uint16_t)(head - rx_tail) < RX_BUFFER_SIZE) {
+                rx_buffer[head & (RX_BUFFER_SIZE - 1)] = byte;
+                COMPILER_BARRIER();
+                rx_head = head + 1;
+            } else {
+                rx_dropped++;
+            }
+        }
+    }
+    
+    if ((sr & USART_SR_TXE) && (HWREG(USART_CR1(USART1_BASE)) & USART_CR1_TXEIE)) {
+        uint16_t tail = tx_tail;
+        if (tail != tx_head) {
+            HWREG(USART_DR(USART1_BASE)) = tx_buffer[tail & (TX_BUFFER_SIZE - 1)];
+            tx_tail = tail + 1;
+        } else {
+            // Drained. write_bytes() re-enables TXEIE after queueing, so a
+            // write racing with this can't be stranded in the ring.
+            HWREG(USART_CR1(USART1_BASE)) &= ~USART_CR1_TXEIE;
+        }
+    }
+}
+
+void USART1_IRQHandler(void) {
+    g_uart.on_interrupt();
+}
+
 void UARTDriver::write_byte(uint8_t byte) {
-    while (!(HWREG(USART_SR(USART1_BASE)) & (1 << 7)));
-    HWREG(USART_DR(USART1_BASE)) = byte;
+    write_bytes(&byte, 1);
 }
 
-void UARTDriver::write_bytes(const uint8_t* data, uint16_t len) {
+uint16_t UARTDriver::write_bytes(const uint8_t* data, uint16_t len) {
     if (simulation_mode) {
         // In simulation, output to stdout (can be piped to telemetry bridge)
         fwrite(data, 1, len, stdout);
         fflush(stdout);
-    } else {
-        // Real hardware UART
-        for (uint16_t i = 0; i < len; i++) {
-            write_byte(data[i]);
-        }
+        return len;
+    }
+    
+    // Real hardware UART: queue for the TXE interrupt and return
+    uint16_t head = tx_head;
+    uint16_t space = TX_BUFFER_SIZE - (uint16_t)(head - tx_tail);
+    uint16_t queued = len < space ? len : space;
+    for (uint16_t i = 0; i < queued; i++) {
+        tx_buffer[(uint16_t)(head + i) & (TX_BUFFER_SIZE - 1)] = data[i];
+    }
+    COMPILER_BARRIER();
+    tx_head = head + queued;
+    tx_dropped += len - queued;
+    
+    if (queued > 0) {
+        HWREG(USART_CR1(USART1_BASE)) |= USART_CR1_TXEIE;
     }
+    return queued;
 }
 
 uint8_t UARTDriver::read_byte() {
-    while (!(HWREG(USART_SR(USART1_BASE)) & (1 << 5)));
-    return (uint8_t)HWREG(USART_DR(USART1_BASE));
+    uint8_t byte = 0;
+    read_bytes(&byte, 1);
+    return byte;
+}
+
+uint16_t UARTDriver::read_bytes(uint8_t* out, uint16_t max_len) {
+    uint16_t tail = rx_tail;
+    uint16_t available = (uint16_t)(rx_head - tail);
+    COMPILER_BARRIER();
+    uint16_t count = available < max_len ? available : max_len;
+    for (uint16_t i = 0; i < count; i++) {
+        out[i] = rx_buffer[(uint16_t)(tail + i) & (RX_BUFFER_SIZE - 1)];
+    }
+    COMPILER_BARRIER();
+    rx_tail = tail + count;
+    return count;
 }
 
-uint16_t UARTDriver::read_available() {
-    return (HWREG(USART_SR(USART1_BASE)) & (1 << 5)) ? 1 : 0;
+uint16_t UARTDriver::read_available() const {
+    return (uint16_t)(rx_head - rx_tail);
+}
+
+uint16_t UARTDriver::write_free() const {
+    return TX_BUFFER_SIZE - (uint16_t)(tx_head - tx_tail);
+}
+
+UARTStats UARTDriver::get_stats() const {
+    UARTStats stats;
+    stats.rx_dropped = rx_dropped;
+    stats.rx_overruns = rx_overruns;
+    stats.rx_errors = rx_errors;
+    stats.tx_dropped = tx_dropped;
+    return stats;
+}
+
+SystemClock::SystemClock() {}
+SystemClock::~SystemClock() {}
+
+bool SystemClock::init() {
+    HWREG(DEMCR) |= (1 << 24);     // TRCENA
+    HWREG(DWT_CYCCNT) = 0;
+    HWREG(DWT_CTRL) |= 1;          // CYCCNTENA
+    
+    ticks_ms = 0;
+    HWREG(SYST_RVR) = SYSTEM_CLOCK_HZ / 1000 - 1;
+    HWREG(SYST_CVR) = 0;
+    HWREG(SYST_CSR) = SYST_CSR_CLKSOURCE | SYST_CSR_TICKINT | SYST_CSR_ENABLE;
+    return true;
+}
+
+uint32_t SystemClock::micros() const {
+    // SysTick counts down from RVR. Re-read the tick count if it changed
+    // while sampling the counter, so the two halves belong to the same ms.
+    // If the counter reloaded but the tick is still pending (called from a
+    // higher-priority ISR or with interrupts masked), ticks_ms is one behind:
+    // count the pending ms and re-sample the counter after the reload.
+    // PENDSTSET is used rather than COUNTFLAG, which clears on read.
+    uint32_t ms, cvr;
+    bool pending;
+    do {
+        ms = ticks_ms;
+        cvr = HWREG(SYST_CVR);
+        pending = (HWREG(SCB_ICSR) & SCB_ICSR_PENDSTSET) != 0;
+        if (pending) cvr = HWREG(SYST_CVR);
+    } while (ms != ticks_ms);
+    if (pending) ms++;
+    uint32_t elapsed = (SYSTEM_CLOCK_HZ / 1000 - 1) - cvr;
+    return ms * 1000 + elapsed / CYCLES_PER_US;
+}
+
+uint32_t SystemClock::cycles() const {
+    return HWREG(DWT_CYCCNT);
+}
+
+void SysTick_Handler(void) {
+    g_clock.on_tick();
+}
+
+// Bank 1: four 16KB sectors, one 64KB, then seven 128KB
+const uint8_t* FlashDriver::sector_address(uint8_t sector) {
+    uint32_t address;
+    if (sector < 4) {
+        address = 0x08000000 + sector * 0x4000;
+    } else if (sector == 4) {
+        address = 0x08010000;
+    } else {
+        address = 0x08020000 + (sector - 5) * 0x20000;
+    }
+    return (const uint8_t*)(uintptr_t)address;
+}
+
+uint32_t FlashDriver::sector_size(uint8_t sector) {
+    if (sector < 4) return 0x4000;
+    if (sector == 4) return 0x10000;
+    return 0x20000;
+}
+
+bool FlashDriver::wait_ready() {
+    while (HWREG(FLASH_SR) & FLASH_SR_BSY) {}
+    uint32_t errors = HWREG(FLASH_SR) & FLASH_SR_ERRORS;
+    HWREG(FLASH_SR) = errors;  // write 1 to clear
+    return errors == 0;
+}
+
+bool FlashDriver::erase_sector(uint8_t sector) {
+    if (sector > 11) return false;
+    if (!wait_ready()) return false;
+    HWREG(FLASH_KEYR) = FLASH_KEY1;
+    HWREG(FLASH_KEYR) = FLASH_KEY2;
+    
+    HWREG(FLASH_CR) = FLASH_CR_PSIZE_X32 | FLASH_CR_SER | ((uint32_t)sector << FLASH_CR_SNB_SHIFT);
+    HWREG(FLASH_CR) |= FLASH_CR_STRT;
+    bool ok = wait_ready();
+    HWREG(FLASH_CR) = FLASH_CR_LOCK;
+    
+    // The data cache may still hold the old contents
+    HWREG(FLASH_ACR) &= ~FLASH_ACR_DCEN;
+    HWREG(FLASH_ACR) |= FLASH_ACR_DCRST;
+    HWREG(FLASH_ACR) &= ~FLASH_ACR_DCRST;
+    HWREG(FLASH_ACR) |= FLASH_ACR_DCEN;
+    return ok;
+}
+
+bool FlashDriver::program(const void* dst, const uint32_t* words, uint16_t count) {
+    if (((uintptr_t)dst & 3) != 0) return false;
+    if (!wait_ready()) return false;
+    HWREG(FLASH_KEYR) = FLASH_KEY1;
+    HWREG(FLASH_KEYR) = FLASH_KEY2;
+    
+    bool ok = true;
+    volatile uint32_t* out = (volatile uint32_t*)(uintptr_t)dst;
+    HWREG(FLASH_CR) = FLASH_CR_PSIZE_X32 | FLASH_CR_PG;
+    for (uint16_t i = 0; i < count && ok; i++) {
+        out[i] = words[i];
+        ok = wait_ready();
+    }
+    HWREG(FLASH_CR) = FLASH_CR_LOCK;
+    return ok;
 }
@@ -4,12 +4,34 @@
 #include "ethernet_comm.h"
 #include "motor_config.h"
 #include "hardware_hal.h"
+#include "telemetry_scheduler.h"
+#include "task_scheduler.h"
+#include "param_store.h"
 #include <cstring>
 #include <cmath>
 
 static RobotState g_robot_state = {};
 static ProtocolHandler protocol_handler;
+static TelemetryScheduler telemetry_scheduler;
+static TaskScheduler task_scheduler;
+
+static const uint32_t UART_BAUDRATE = 57600;
 static MotorConfigManager motor_config;
+static PixhawkControl pixhawk;
+
+static uint16_t pwm_ccr[PWMDriver::CHANNELS];  // timer compare values, written by pwm_task
+
+static ParamStore param_store;
+static uint32_t param_pending = 0;             // VALUE replies owed, bit per ParamId
+static uint8_t param_status[PARAM_COUNT];      // ParamStatus for each owed reply
+static uint8_t param_unknown_id = PARAM_ID_ALL;  // last request for an id we don't have
+static bool params_dirty = false;
+static uint32_t params_changed_ms = 0;
+static const uint32_t PARAM_SAVE_DELAY_MS = 500;  // coalesces a burst of writes into one record
+static const float PID_GAIN_MAX = 100.0f;
+
+static_assert(sizeof(PIDTuning) == (PARAM_PID_DEPTH_D - PARAM_PID_ROLL_P + 1) * sizeof(float),
+              "PID parameters map onto PIDTuning in order");
 
 void initialize_robot_state() {
     g_robot_state.armed = 0;
@@ -60,97 +82,260 @@ void initialize_robot_state() {
     g_robot_state.yaw = 0.0f;
 }
 
+static void sensors_task(uint32_t now_ms) {
+    (void)now_ms;
+    IMUData imu = pixhawk.read_imu();
+    DepthData depth = pixhawk.read_depth();
+    
+    g_robot_state.sensors.accel_x = imu.accel_x;
+    g_robot_state.sensors.accel_y = imu.accel_y;
+    g_robot_state.sensors.accel_z = imu.accel_z;
+    g_robot_state.sensors.gyro_x = imu.gyro_x;
+    g_robot_state.sensors.gyro_y = imu.gyro_y;
+    g_robot_state.sensors.gyro_z = imu.gyro_z;
+    g_robot_state.sensors.mag_x = imu.mag_x;
+    g_robot_state.sensors.mag_y = imu.mag_y;
+    g_robot_state.sensors.mag_z = imu.mag_z;
+    g_robot_state.sensors.depth = depth.depth;
+    g_robot_state.sensors.temperature = depth.temperature;
+    g_robot_state.sensors.pressure = depth.pressure;
+}
+
+static void disarm_outputs() {
+    // Neutral, not the minimum pulse: on a bidirectional ESC that is full reverse
+    uint16_t neutral = PWMDriver::pulse_to_ccr(ESC_NEUTRAL_US);
+    for (uint8_t i = 0; i < PWMDriver::CHANNELS; i++) {
+        pwm_ccr[i] = neutral;
+    }
+}
+
+static void apply_control(const ControlPacket& control) {
+    if (control.flags & CONTROL_FLAG_REQUEST_KEYFRAME) {
+        telemetry_scheduler.request_keyframe();
+    }
+    if (control.flags & CONTROL_FLAG_REQUEST_CONFIG) {
+        telemetry_scheduler.request_config();
+    }
+    g_robot_state.armed = control.armed;
+    g_robot_state.flight_mode = control.flight_mode;
+    
+    if (g_robot_state.armed) {
+        // Check if direct motor commands are provided (motor test mode)
+        bool has_motor_commands = (control.motor_count > 0);
+        
+        if (has_motor_commands) {
+            // Direct motor test mode - throttle is relative to neutral, so the
+            // GUI's 0..1 spins forward and a negative value would run in reverse
+            for (uint8_t i = 0; i < control.motor_count && i < PWMDriver::CHANNELS; i++) {
+                uint16_t pulse_us = ESC_NEUTRAL_US;  // Disabled - neutral
+                if (control.motors[i].enabled) {
+                    float throttle = control.motors[i].throttle;
+                    throttle = (throttle < -1.0f) ? -1.0f : (throttle > 1.0f) ? 1.0f : throttle;
+                    pulse_us = (uint16_t)((float)ESC_NEUTRAL_US + throttle * ESC_HALF_SPAN_US);
+                }
+                pwm_ccr[i] = PWMDriver::pulse_to_ccr(pulse_us);
+            }
+        } else {
+            // Normal flight mode - allocate a body wrench across the thrusters
+            // For now, use roll/pitch/yaw from robot state and throttle from trigger_right (sent in control packet)
+            float wrench[AXIS_COUNT] = {0};
+            wrench[AXIS_HEAVE] = -control.motors[0].throttle;  // trigger ascends; NED z is down
+            wrench[AXIS_ROLL] = g_robot_state.roll * 0.017453f;
+            wrench[AXIS_PITCH] = g_robot_state.pitch * 0.017453f;
+            wrench[AXIS_YAW] = g_robot_state.yaw * 0.017453f;
+            
+            motor_config.mix_to_ccr(wrench, pwm_ccr);
+        }
+    } else {
+        disarm_outputs();
+    }
+}
+
+static bool get_param(uint8_t id, float& value) {
+    if (id == PARAM_FRAME_TYPE) {
+        value = (float)motor_config.get_frame_type();
+    } else if (id == PARAM_MOTOR_REVERSED) {
+        value = (float)motor_config.get_reversed_mask();
+    } else if (id >= PARAM_THRUST_FACTOR_1 && id < PARAM_THRUST_FACTOR_1 + MAX_MOTORS) {
+        value = motor_config.get_thrust_factor(id - PARAM_THRUST_FACTOR_1);
+    } else if (id >= PARAM_PID_ROLL_P && id <= PARAM_PID_DEPTH_D) {
+        // PIDTuning is packed, so copy rather than take a member's address
+        memcpy(&value, (const uint8_t*)&g_robot_state.pid_tuning + (id - PARAM_PID_ROLL_P) * sizeof(float), sizeof(value));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool is_whole(float value, float max) {
+    return value >= 0.0f && value <= max && value == (float)(int)value;
+}
+
+static ParamStatus set_param(uint8_t id, float value) {
+    if (id == PARAM_FRAME_TYPE) {
+        // Never swap the mixer under a live vehicle
+        if (g_robot_state.armed || !is_whole(value, 255.0f) || !motor_config.set_frame((FrameType)(int)value)) {
+            return PARAM_STATUS_INVALID;
+        }
+        // The frame brought its own default reversal
+        param_status[PARAM_MOTOR_REVERSED] = PARAM_STATUS_OK;
+        param_pending |= 1u << PARAM_MOTOR_REVERSED;
+    } else if (id == PARAM_MOTOR_REVERSED) {
+        if (!is_whole(value, 255.0f)) return PARAM_STATUS_INVALID;
+        motor_config.set_reversed_mask((uint8_t)value);
+    } else if (id >= PARAM_THRUST_FACTOR_1 && id < PARAM_THRUST_FACTOR_1 + MAX_MOTORS) {
+        if (!motor_config.set_thrust_factor(id - PARAM_THRUST_FACTOR_1, value)) return PARAM_STATUS_INVALID;
+    } else if (id >= PARAM_PID_ROLL_P && id <= PARAM_PID_DEPTH_D) {
+        if (!(value >= 0.0f && value <= PID_GAIN_MAX)) return PARAM_STATUS_INVALID;
+        memcpy((uint8_t*)&g_robot_state.pid_tuning + (id - PARAM_PID_ROLL_P) * sizeof(float), &value, sizeof(value));
+    } else {
+        return PARAM_STATUS_UNKNOWN_ID;
+    }
+    params_dirty = true;
+    params_changed_ms = g_clock.millis();
+    return PARAM_STATUS_OK;
+}
+
+static void apply_param(const ParamPacket& param) {
+    if (param.op == PARAM_OP_READ && param.param_id == PARAM_ID_ALL) {
+        for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+            param_status[id] = PARAM_STATUS_OK;
+        }
+        param_pending = (uint32_t)((1ull << PARAM_COUNT) - 1);
+        return;
+    }
+    if (param.op != PARAM_OP_READ && param.op != PARAM_OP_WRITE) {
+        return;
+    }
+    if (param.param_id >= PARAM_COUNT) {
+        param_unknown_id = param.param_id;
+        return;
+    }
+    
+    uint8_t status = PARAM_STATUS_OK;
+    if (param.op == PARAM_OP_WRITE) {
+        status = set_param(param.param_id, param.value);
+    }
+    param_status[param.param_id] = status;
+    param_pending |= 1u << param.param_id;
+}
+
+// Replies take their bytes from the telemetry budget, so a READ of every
+// parameter trickles out without starving the telemetry stream
+static void send_param_replies(uint32_t now_ms) {
+    while ((param_pending || param_unknown_id != PARAM_ID_ALL) &&
+           g_uart.write_free() >= PARAM_PACKET_SIZE &&
+           telemetry_scheduler.reserve(PARAM_PACKET_SIZE, now_ms)) {
+        ParamPacket reply;
+        reply.packet_type = PACKET_TYPE_PARAM;
+        reply.op = PARAM_OP_VALUE;
+        reply.value = 0.0f;
+        if (param_unknown_id != PARAM_ID_ALL) {
+            reply.param_id = param_unknown_id;
+            reply.status = PARAM_STATUS_UNKNOWN_ID;
+            param_unknown_id = PARAM_ID_ALL;
+        } else {
+            uint8_t id = (uint8_t)__builtin_ctz(param_pending);
+            param_pending &= ~(1u << id);
+            float value = 0.0f;
+            get_param(id, value);
+            reply.param_id = id;
+            reply.status = param_status[id];
+            reply.value = value;
+        }
+        uint8_t tx_buffer[PARAM_PACKET_SIZE];
+        g_uart.write_bytes(tx_buffer, encode_param_packet(reply, tx_buffer));
+    }
+}
+
+static void save_params(uint32_t now_ms) {
+    if (!params_dirty || now_ms - params_changed_ms < PARAM_SAVE_DELAY_MS) return;
+    // Starting a new sector erases it, which stalls the core for a second or
+    // more; wait for disarm. Plain appends take well under a millisecond.
+    if (g_robot_state.armed && param_store.save_needs_erase()) return;
+    
+    StoredParams params;
+    motor_config.save_config(params.motors);
+    params.pid = g_robot_state.pid_tuning;
+    if (param_store.save(params)) {
+        params_dirty = false;
+    } else {
+        params_changed_ms = now_ms;  // retry after another delay
+    }
+}
+
+static void load_params() {
+    StoredParams params;
+    if (!param_store.load(params)) return;  // nothing saved yet: keep the defaults
+    motor_config.load_config(params.motors);
+    g_robot_state.pid_tuning = params.pid;
+}
+
+static void control_task(uint32_t now_ms) {
+    // Drain everything the UART interrupt buffered since the last run;
+    // accepted packets are applied through apply_control() and apply_param()
+    uint8_t chunk[64];
+    uint16_t n;
+    while ((n = g_uart.read_bytes(chunk, sizeof(chunk))) > 0) {
+        protocol_handler.parse_control_packet(chunk, n);
+    }
+    protocol_handler.update_rates(now_ms);
+    save_params(now_ms);
+}
+
+static void pwm_task(uint32_t now_ms) {
+    (void)now_ms;
+    g_pwm.write_ccr(pwm_ccr);
+}
+
+static void telemetry_task(uint32_t now_ms) {
+    const ControlDecoderStats& control_stats = protocol_handler.get_control_stats();
+    g_robot_state.link = telemetry_scheduler.get_link_utilization();
+    g_robot_state.link.control_rx_per_s = control_stats.packets_per_s;
+    g_robot_state.link.control_errors =
+        (uint16_t)(control_stats.framing_errors < 65535 ? control_stats.framing_errors : 65535);
+    g_robot_state.timing = task_scheduler.get_timing();
+    
+    send_param_replies(now_ms);
+    
+    // Only consume a sequence number when the scheduler has something due.
+    // write_bytes() truncates to the free space, and a partial frame costs the
+    // GUI a resync, so wait for room for a whole one; due groups stay due.
+    if (g_uart.write_free() >= TELEMETRY_PACKET_SIZE &&
+        telemetry_scheduler.poll(g_robot_state, now_ms)) {
+        TelemetryPacket telemetry = protocol_handler.create_telemetry_packet(g_robot_state);
+        uint8_t tx_buffer[TELEMETRY_PACKET_SIZE];
+        g_uart.write_bytes(tx_buffer, telemetry_scheduler.encode(telemetry, tx_buffer, sizeof(tx_buffer)));
+    }
+}
+
+// Run in table order within a tick: fresh sensors feed the mixer, whose
+// output goes straight to the ESCs. Telemetry polls at twice its fastest group.
+static const TaskEntry TASKS[TASK_COUNT] = {
+    {"sensors",   sensors_task,   10},
+    {"control",   control_task,    5},
+    {"pwm",       pwm_task,        5},
+    {"telemetry", telemetry_task,  5},
+};
+
 int main() {
     // Initialize hardware
-    g_uart.init(57600);
+    g_clock.init();
+    g_uart.init(UART_BAUDRATE);
     g_pwm.init();
     
     initialize_robot_state();
     protocol_handler.init();
+    protocol_handler.set_control_handler(apply_control);
+    protocol_handler.set_param_handler(apply_param);
     motor_config.init();
-    
-    uint8_t rx_buffer[512];
-    uint16_t rx_len = 0;
-    float motor_outputs[8] = {0};
-    PixhawkControl pixhawk;
+    load_params();
+    telemetry_scheduler.init(UART_BAUDRATE);
     pixhawk.init();
+    disarm_outputs();
     
-    while (1) {
-        // Read actual sensor data from hardware
-        IMUData imu = pixhawk.read_imu();
-        DepthData depth = pixhawk.read_depth();
-        
-        g_robot_state.sensors.accel_x = imu.accel_x;
-        g_robot_state.sensors.accel_y = imu.accel_y;
-        g_robot_state.sensors.accel_z = imu.accel_z;
-        g_robot_state.sensors.gyro_x = imu.gyro_x;
-        g_robot_state.sensors.gyro_y = imu.gyro_y;
-        g_robot_state.sensors.gyro_z = imu.gyro_z;
-        g_robot_state.sensors.mag_x = imu.mag_x;
-        g_robot_state.sensors.mag_y = imu.mag_y;
-        g_robot_state.sensors.mag_z = imu.mag_z;
-        g_robot_state.sensors.depth = depth.depth;
-        g_robot_state.sensors.temperature = depth.temperature;
-        g_robot_state.sensors.pressure = depth.pressure;
-        
-        TelemetryPacket telemetry = protocol_handler.create_telemetry_packet(g_robot_state);
-        g_uart.write_bytes((uint8_t*)&telemetry, sizeof(telemetry));
-        
-        // Small delay to prevent UART buffer overflow (~10ms at 168MHz)
-        for (volatile int i = 0; i < 100000; i++);
-                if (g_uart.read_available()) {
-            uint8_t byte = g_uart.read_byte();
-            if (rx_len < 512) {
-                rx_buffer[rx_len++] = byte;
-            }
-            
-            if (rx_len >= sizeof(ControlPacket)) {
-                ControlPacket* ctrl = (ControlPacket*)rx_buffer;
-                if (ctrl->packet_type == 1) {
-                    g_robot_state.armed = ctrl->armed;
-                    g_robot_state.flight_mode = ctrl->flight_mode;
-                    
-                    if (g_robot_state.armed) {
-                        // Check if direct motor commands are provided (motor test mode)
-                        bool has_motor_commands = (ctrl->motor_count > 0);
-                        
-                        if (has_motor_commands) {
-                            // Direct motor test mode - use provided throttle values
-                            for (uint8_t i = 0; i < ctrl->motor_count && i < 8; i++) {
-                                if (ctrl->motors[i].enabled) {
-                                    float throttle = ctrl->motors[i].throttle;
-                                    throttle = (throttle < 0.0f) ? 0.0f : (throttle > 1.0f) ? 1.0f : throttle;
-                                    uint16_t pwm = (uint16_t)(1100.0f + (throttle * 800.0f));
-                                    g_pwm.set_pwm(i, pwm);
-                                } else {
-                                    g_pwm.set_pwm(i, 1000);  // Disabled - neutral
-                                }
-                            }
-                        } else {
-                            // Normal flight mode - use roll/pitch/yaw/throttle from control packet
-                            // For now, use roll/pitch/yaw from robot state and throttle from trigger_right (sent in control packet)
-                            float roll = g_robot_state.roll * 0.017453f;
-                            float pitch = g_robot_state.pitch * 0.017453f;
-                            float yaw = g_robot_state.yaw * 0.017453f;
-                            float throttle = ctrl->motors[0].throttle;  // Use first motor's throttle as overall throttle
-                            
-                            motor_config.calculate_motor_commands(roll, pitch, yaw, throttle, motor_outputs);
-                            
-                            for (uint8_t i = 0; i < 8; i++) {
-                                uint16_t pwm = (uint16_t)(1100.0f + (motor_outputs[i] * 800.0f));
-                                g_pwm.set_pwm(i, pwm);
-                            }
-                        }
-                    } else {
-                        for (uint8_t i = 0; i < 8; i++) {
-                            g_pwm.set_pwm(i, 1000);
-                        }
-                    }
-                }
-                rx_len = 0;
-            }
-        }
-    }
+    task_scheduler.init(TASKS, TASK_COUNT, g_clock.millis());
+    task_scheduler.run();
     
     return 0;
 }
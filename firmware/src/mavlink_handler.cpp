@@ -1,29 +1,103 @@
 #include "mavlink_handler.h"
+#include "hardware_hal.h"
 
-ProtocolHandler::ProtocolHandler() : sequence_counter(0) {}
+ProtocolHandler::ProtocolHandler()
+    : sequence_counter(0), last_control_sequence(0), control_handler(nullptr), param_handler(nullptr) {
+    init();
+}
 
 ProtocolHandler::~ProtocolHandler() {}
 
 bool ProtocolHandler::init() {
+    rx_len = 0;
+    memset(&control_stats, 0, sizeof(control_stats));
+    window_start_ms = 0;
+    window_packets = 0;
+    return true;
+}
+
+uint16_t ProtocolHandler::frame_size(uint8_t type) {
+    switch (type) {
+        case PACKET_TYPE_CONTROL:
+            return CONTROL_PACKET_SIZE;
+        case PACKET_TYPE_PARAM:
+            return PARAM_PACKET_SIZE;
+        default:
+            return 0;
+    }
+}
+
+uint16_t ProtocolHandler::parse_control_packet(const uint8_t* data, uint16_t len) {
+    uint16_t accepted = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        uint8_t byte = data[i];
+        if (rx_len == 0 && frame_size(byte) == 0) {
+            control_stats.bytes_discarded++;
+            continue;
+        }
+        rx_frame[rx_len++] = byte;
+        // A resync can leave more than one frame's worth buffered
+        while (rx_len > 0 && rx_len >= frame_size(rx_frame[0])) {
+            if (!dispatch_frame()) {
+                control_stats.framing_errors++;
+                resync();
+                continue;
+            }
+            uint16_t size = frame_size(rx_frame[0]);
+            rx_len -= size;
+            memmove(rx_frame, rx_frame + size, rx_len);
+            control_stats.packets++;
+            accepted++;
+        }
+    }
+    return accepted;
+}
+
+bool ProtocolHandler::dispatch_frame() {
+    if (rx_frame[0] == PACKET_TYPE_CONTROL) {
+        ControlPacket control;
+        if (!decode_control_packet(rx_frame, CONTROL_PACKET_SIZE, control)) return false;
+        window_packets++;
+        note_control_received(control);
+        if (control_handler) control_handler(control);
+    } else {
+        ParamPacket param;
+        if (!decode_param_packet(rx_frame, PARAM_PACKET_SIZE, param)) return false;
+        if (param_handler) param_handler(param);
+    }
     return true;
 }
 
-void ProtocolHandler::parse_control_packet(const uint8_t* data, uint16_t len) {
-    if (len < sizeof(ControlPacket)) return;
+void ProtocolHandler::resync() {
+    // False sync or corrupted frame - restart at the next type byte after the
+    // current start, keeping the bytes that follow it
+    uint16_t start = 1;
+    while (start < rx_len && frame_size(rx_frame[start]) == 0) start++;
+    control_stats.bytes_discarded += start;
+    rx_len -= start;
+    memmove(rx_frame, rx_frame + start, rx_len);
+}
+
+void ProtocolHandler::update_rates(uint32_t now_ms) {
+    uint32_t elapsed = now_ms - window_start_ms;
+    if (elapsed < RATE_WINDOW_MS) return;
+    
+    control_stats.packets_per_s = (uint16_t)(window_packets * 1000 / elapsed);
+    window_start_ms = now_ms;
+    window_packets = 0;
+}
+
+void ProtocolHandler::note_control_received(const ControlPacket& control) {
+    last_control_sequence = control.sequence;
 }
 
 TelemetryPacket ProtocolHandler::create_telemetry_packet(const RobotState& state) {
     TelemetryPacket pkt;
-    pkt.packet_type = 2;
+    pkt.packet_type = PACKET_TYPE_TELEMETRY;
+    pkt.sequence = sequence_counter++;
+    pkt.timestamp_ms = g_clock.millis();
+    pkt.control_echo = last_control_sequence;
     pkt.state = state;
-    pkt.checksum = calculate_checksum((uint8_t*)&pkt, sizeof(pkt) - 1);
+    pkt.crc = crc16((const uint8_t*)&pkt, TELEMETRY_PACKET_SIZE - 2);
     return pkt;
 }
-
-uint8_t ProtocolHandler::calculate_checksum(const uint8_t* data, uint16_t len) {
-    uint8_t checksum = 0;
-    for (uint16_t i = 0; i < len; i++) {
-        checksum ^= data[i];
-    }
-    return checksum;
-}
@@ -0,0 +1,120 @@
+// Micro-benchmark: fixed-point mix_to_ccr() against the float ThrustAllocator
+// path followed by a separate float -> pulse -> CCR conversion.
+// Host:  cmake --build build --target mixer_bench && ./build/src/mixer_bench
+// QEMU:  build with the ARM toolchain, then run build/src/mixer_bench in place
+//        of the firmware image with -icount shift=0, so the cycle counts
+//        below become instruction counts.
+#include "motor_config.h"
+#include "hardware_hal.h"
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__arm__)
+static uint32_t bench_cycles() {
+    return g_clock.cycles();
+}
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint32_t bench_cycles() {
+    return (uint32_t)__rdtsc();
+}
+#else
+#include <chrono>
+static uint32_t bench_cycles() {
+    return (uint32_t)std::chrono::steady_clock::now().time_since_epoch().count();
+}
+#endif
+
+static const uint32_t INPUT_COUNT = 256;
+static const uint32_t ROUNDS = 200;
+
+struct MixInput {
+    float wrench[AXIS_COUNT];
+};
+
+static MixInput inputs[INPUT_COUNT];
+static volatile uint16_t sink;
+
+static float random_unit() {
+    return (float)std::rand() / (float)RAND_MAX;
+}
+
+static void print_line(const char* text) {
+    uint16_t len = 0;
+    while (text[len]) len++;
+    g_uart.write_bytes((const uint8_t*)text, len);
+}
+
+// Float reference: allocate, then convert each output to a pulse and a compare value
+static void scalar_to_ccr(MotorConfigManager& mixer, const MixInput& in, uint16_t* ccr) {
+    float outputs[MAX_MOTORS] = {0};
+    mixer.calculate_motor_commands(in.wrench, outputs);
+    for (uint8_t i = 0; i < PWMDriver::CHANNELS; i++) {
+        uint16_t pwm = (uint16_t)(ESC_NEUTRAL_US - ESC_HALF_SPAN_US + (outputs[i] * 2 * ESC_HALF_SPAN_US));
+        ccr[i] = PWMDriver::pulse_to_ccr(pwm);
+    }
+}
+
+template <typename F>
+static uint32_t cycles_per_call(F fn) {
+    uint32_t best = 0xFFFFFFFFu;
+    for (uint32_t r = 0; r < ROUNDS; r++) {
+        uint32_t start = bench_cycles();
+        for (uint32_t i = 0; i < INPUT_COUNT; i++) {
+            fn(inputs[i]);
+        }
+        uint32_t elapsed = bench_cycles() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return best / INPUT_COUNT;
+}
+
+int main() {
+#if defined(__arm__)
+    g_clock.init();  // DWT cycle counter; touches hardware registers
+#endif
+    
+    for (uint32_t i = 0; i < INPUT_COUNT; i++) {
+        // Large enough that most inputs hit the prioritized saturation
+        for (uint8_t a = 0; a < AXIS_COUNT; a++) {
+            inputs[i].wrench[a] = random_unit() * 2.0f - 1.0f;
+        }
+    }
+    
+    static const FrameType frames[] = {FRAME_QUADCOPTER, FRAME_HEXACOPTER, FRAME_OCTOCOPTER, FRAME_VECTORED};
+    char line[160];
+    for (FrameType frame : frames) {
+        MotorConfigManager mixer;
+        mixer.init();
+        mixer.set_frame(frame);
+        
+        // Agreement with the float path, in timer counts
+        int max_error = 0;
+        for (uint32_t i = 0; i < INPUT_COUNT; i++) {
+            uint16_t expected[PWMDriver::CHANNELS];
+            uint16_t actual[PWMDriver::CHANNELS];
+            scalar_to_ccr(mixer, inputs[i], expected);
+            mixer.mix_to_ccr(inputs[i].wrench, actual);
+            for (uint8_t c = 0; c < mixer.get_current_frame().num_motors; c++) {
+                int error = abs((int)expected[c] - (int)actual[c]);
+                if (error > max_error) max_error = error;
+            }
+        }
+        
+        uint32_t scalar = cycles_per_call([&](const MixInput& in) {
+            uint16_t ccr[PWMDriver::CHANNELS];
+            scalar_to_ccr(mixer, in, ccr);
+            sink = ccr[0];
+        });
+        uint32_t fixed = cycles_per_call([&](const MixInput& in) {
+            uint16_t ccr[PWMDriver::CHANNELS];
+            mixer.mix_to_ccr(in.wrench, ccr);
+            sink = ccr[0];
+        });
+        
+        snprintf(line, sizeof(line), "%-24s float+convert %5lu cycles | fixed %5lu cycles | max diff %d counts\n",
+            mixer.get_current_frame().name, (unsigned long)scalar, (unsigned long)fixed, max_error);
+        print_line(line);
+    }
+    return 0;
+}
@@ -1,153 +1,202 @@
 #include "motor_config.h"
-#include <cmath>
+#include "hardware_hal.h"
 
-static void simple_memset(void* ptr, int val, unsigned int size) {
-    unsigned char* p = (unsigned char*)ptr;
-    for (unsigned int i = 0; i < size; i++) {
-        p[i] = (unsigned char)val;
-    }
+// Per-motor row gain: Q13, |gain| <= 2.0. Applied to the Q28 row sums
+// (at most three unit products each) it stays below 2^31.
+static const int ROW_GAIN_SHIFT = 13;
+
+static inline int32_t apply_row_gain(int32_t v, int16_t gain) {
+    return (int32_t)(((int64_t)v * gain) >> ROW_GAIN_SHIFT);
+}
+
+// Dual 16x16 multiply-accumulate: acc + lo(a)*lo(b) + hi(a)*hi(b)
+static inline int32_t smlad(uint32_t a, uint32_t b, int32_t acc) {
+#if defined(__ARM_FEATURE_DSP)
+    int32_t result;
+    __asm__("smlad %0, %1, %2, %3" : "=r"(result) : "r"(a), "r"(b), "r"(acc));
+    return result;
+#else
+    return acc + (int16_t)a * (int16_t)b + (int16_t)(a >> 16) * (int16_t)(b >> 16);
+#endif
 }
 
 MotorConfigManager::MotorConfigManager() {
-    simple_memset(&current_frame, 0, sizeof(current_frame));
-    simple_memset(&mixing_matrix, 0, sizeof(mixing_matrix));
+    frame = find_frame_definition(FRAME_VECTORED);
+    allocator.configure(&frame->mix);
+    reversed_mask = frame->reversed_mask;
+    for (uint8_t i = 0; i < MAX_MOTORS; i++) {
+        thrust_factor[i] = 1.0f;
+    }
+    update_row_gains();
 }
 
 MotorConfigManager::~MotorConfigManager() {}
 
 bool MotorConfigManager::init() {
-    build_vectored_frame(current_frame);
-    recalculate_mixing_matrix();
-    return true;
+    return set_frame(FRAME_VECTORED);
 }
 
-bool MotorConfigManager::set_frame(FrameType frame) {
-    switch (frame) {
-        case FRAME_VECTORED:
-            build_vectored_frame(current_frame);
-            break;
-        case FRAME_QUADCOPTER:
-            build_quadcopter_frame(current_frame);
-            break;
-        case FRAME_HEXACOPTER:
-            build_hexacopter_frame(current_frame);
-            break;
-        case FRAME_OCTOCOPTER:
-            build_octocopter_frame(current_frame);
-            break;
-        default:
-            return false;
-    }
-    recalculate_mixing_matrix();
+bool MotorConfigManager::set_frame(FrameType type) {
+    const FrameDefinition* def = find_frame_definition(type);
+    if (!def) {
+        return false;
+    }
+    frame = def;
+    allocator.configure(&def->mix);
+    reversed_mask = def->reversed_mask;
+    update_row_gains();
     return true;
 }
 
-bool MotorConfigManager::load_config(const char* config_file) {
+bool MotorConfigManager::load_config(const MotorParams& params) {
+    if (!set_frame((FrameType)params.frame_type)) {
+        return false;
+    }
+    reversed_mask = params.reversed_mask;
+    for (uint8_t i = 0; i < MAX_MOTORS; i++) {
+        float factor = params.thrust_factor[i];
+        // Also rejects NaN from a record written by an older layout
+        thrust_factor[i] = (factor >= THRUST_FACTOR_MIN && factor <= THRUST_FACTOR_MAX) ? factor : 1.0f;
+    }
+    update_row_gains();
     return true;
 }
 
-bool MotorConfigManager::save_config(const char* config_file) {
-    return true;
+void MotorConfigManager::save_config(MotorParams& params) const {
+    params.frame_type = (uint8_t)frame->config.frame_type;
+    params.reversed_mask = reversed_mask;
+    params.reserved[0] = 0;
+    params.reserved[1] = 0;
+    for (uint8_t i = 0; i < MAX_MOTORS; i++) {
+        params.thrust_factor[i] = thrust_factor[i];
+    }
 }
 
-void MotorConfigManager::calculate_motor_commands(float roll, float pitch, float yaw, 
-                                                    float throttle, float* motor_outputs) {
-    for (uint8_t i = 0; i < current_frame.num_motors; i++) {
-        float output = throttle;
-        output += roll * mixing_matrix.roll_mix[i];
-        output += pitch * mixing_matrix.pitch_mix[i];
-        output += yaw * mixing_matrix.yaw_mix[i];
-        
-        if (current_frame.motors[i].reversed) {
-            output = 1.0f - output;
-        }
-        
-        output = (output < 0.0f) ? 0.0f : (output > 1.0f) ? 1.0f : output;
-        motor_outputs[i] = output;
+void MotorConfigManager::calculate_motor_commands(const float* wrench, float* motor_outputs) const {
+    float thrust[MAX_MOTORS];
+    allocator.allocate(wrench, thrust, row_gain);
+    for (uint8_t i = 0; i < frame->config.num_motors; i++) {
+        float u = thrust[i];
+        if (u > 1.0f) u = 1.0f;
+        if (u < -1.0f) u = -1.0f;
+        motor_outputs[i] = 0.5f + 0.5f * u;
     }
 }
 
-void MotorConfigManager::set_motor_reversed(uint8_t motor_id, uint8_t reversed) {
-    if (motor_id < current_frame.num_motors) {
-        current_frame.motors[motor_id].reversed = reversed;
+void MotorConfigManager::mix_to_ccr(const float* wrench, uint16_t* ccr) const {
+    uint32_t in_surge_sway = mix_pack_q14x2(mix_to_q14(wrench[AXIS_SURGE]), mix_to_q14(wrench[AXIS_SWAY]));
+    uint32_t in_heave = mix_pack_q14x2(mix_to_q14(wrench[AXIS_HEAVE]), 0);
+    uint32_t in_roll_pitch = mix_pack_q14x2(mix_to_q14(wrench[AXIS_ROLL]), mix_to_q14(wrench[AXIS_PITCH]));
+    uint32_t in_yaw = mix_pack_q14x2(mix_to_q14(wrench[AXIS_YAW]), 0);
+    const MotorMixFixed& mixing = frame->fixed;
+    uint8_t n = frame->config.num_motors;
+    
+    // Attitude first; scale it down as a whole if it alone saturates a thruster
+    int32_t attitude[MAX_MOTORS];
+    int32_t translation[MAX_MOTORS];
+    int32_t peak = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        const uint32_t* row = mixing.rows[i];
+        // The signed gain applies reversal and thrust factor to the whole row
+        translation[i] = apply_row_gain(smlad(row[1], in_heave, smlad(row[0], in_surge_sway, 0)), row_gain_q13[i]);
+        attitude[i] = apply_row_gain(smlad(row[3], in_yaw, smlad(row[2], in_roll_pitch, 0)), row_gain_q13[i]);
+        int32_t a = attitude[i] < 0 ? -attitude[i] : attitude[i];
+        if (a > peak) peak = a;
+    }
+    if (peak > MIX_ONE) {
+        // One reciprocal in Q16: 2^44 / peak. peak < 2^31, so peak >> 13 keeps
+        // at least 15 significant bits and the quotient fits in 17. It is
+        // rounded up and the result clamped, so the peak motor lands exactly on
+        // full scale and leaves translation no room, as in the float path.
+        uint32_t scale = 0x80000000u / (uint32_t)(peak >> 13) + 1;
+        for (uint8_t i = 0; i < n; i++) {
+            int32_t a = (int32_t)(((int64_t)attitude[i] * scale) >> 16);
+            attitude[i] = a > MIX_ONE ? MIX_ONE : a < -MIX_ONE ? -MIX_ONE : a;
+        }
+    }
+    
+    // Then translation, scaled into the headroom the attitude part leaves. The
+    // limiting motor is the one with the smallest room / |t|; compare the
+    // ratios by cross-multiplying and divide only once, for that motor.
+    uint32_t best_room = 1;
+    uint32_t best_t = 1;
+    for (uint8_t i = 0; i < n; i++) {
+        int32_t t = translation[i];
+        if (t == 0) continue;
+        int32_t room = t > 0 ? MIX_ONE - attitude[i] : MIX_ONE + attitude[i];
+        if (room < 0) room = 0;
+        uint32_t t_abs = (uint32_t)(t > 0 ? t : -t);
+        if ((uint64_t)(uint32_t)room * best_t < (uint64_t)best_room * t_abs) {
+            best_room = (uint32_t)room;
+            best_t = t_abs;
+        }
+    }
+    // Q16 translation scale = best_room / best_t (<= 1). Shift both so the
+    // divisor keeps 16 significant bits and the dividend still fits in 32.
+    uint32_t translation_scale = 1u << 16;
+    if (best_room < best_t) {
+        int shift = 31 - __builtin_clz(best_t) - 15;
+        if (shift < 0) shift = 0;
+        translation_scale = (best_room << (16 - shift)) / (best_t >> shift);
+    }
+    
+    int32_t neutral = mixing.ccr_neutral;
+    int32_t half_span = mixing.ccr_half_span;
+    for (uint8_t i = 0; i < n; i++) {
+        int32_t u = attitude[i] + (int32_t)(((int64_t)translation[i] * translation_scale) >> 16);
+        if (u > MIX_ONE) u = MIX_ONE;
+        if (u < -MIX_ONE) u = -MIX_ONE;
+        // Q28 -> Q16 first so the span multiply can't overflow
+        int32_t v = u >> (MIX_OUTPUT_SHIFT - 16);
+        ccr[i] = (uint16_t)(neutral + ((v * half_span) >> 16));
+    }
+    for (uint8_t i = n; i < PWMDriver::CHANNELS; i++) {
+        ccr[i] = mixing.ccr_neutral;
     }
 }
 
-uint8_t MotorConfigManager::get_motor_reversed(uint8_t motor_id) const {
-    if (motor_id < current_frame.num_motors) {
-        return current_frame.motors[motor_id].reversed;
+void MotorConfigManager::set_motor_reversed(uint8_t motor_id, uint8_t reversed) {
+    if (motor_id < frame->config.num_motors) {
+        if (reversed) {
+            reversed_mask |= (uint8_t)(1u << motor_id);
+        } else {
+            reversed_mask &= (uint8_t)~(1u << motor_id);
+        }
+        update_row_gains();
     }
-    return 0;
 }
 
-void MotorConfigManager::recalculate_mixing_matrix() {
-    simple_memset(&mixing_matrix, 0, sizeof(mixing_matrix));
-    
-    for (uint8_t i = 0; i < current_frame.num_motors; i++) {
-        float angle_rad = current_frame.motors[i].angle_deg * 3.14159f / 180.0f;
-        
-        mixing_matrix.roll_mix[i] = cosf(angle_rad);
-        mixing_matrix.pitch_mix[i] = sinf(angle_rad);
-        mixing_matrix.yaw_mix[i] = (i % 2 == 0) ? 1.0f : -1.0f;
-        mixing_matrix.throttle_mix[i] = 1.0f;
-    }
+void MotorConfigManager::set_reversed_mask(uint8_t mask) {
+    reversed_mask = mask;
+    update_row_gains();
 }
 
-void MotorConfigManager::build_vectored_frame(FrameConfig& frame) {
-    frame.frame_type = FRAME_VECTORED;
-    frame.num_motors = 8;
-    strncpy(frame.name, "Vectored ROV (8x motor)", 32);
-    
-    float angles[8] = {0, 45, 90, 135, 180, 225, 270, 315};
-    for (uint8_t i = 0; i < 8; i++) {
-        frame.motors[i].motor_id = i;
-        frame.motors[i].angle_deg = angles[i];
-        frame.motors[i].reversed = 0;
-        frame.motors[i].thrust_factor = 1.0f;
+uint8_t MotorConfigManager::get_motor_reversed(uint8_t motor_id) const {
+    if (motor_id < frame->config.num_motors) {
+        return (reversed_mask >> motor_id) & 1u;
     }
+    return 0;
 }
 
-void MotorConfigManager::build_quadcopter_frame(FrameConfig& frame) {
-    frame.frame_type = FRAME_QUADCOPTER;
-    frame.num_motors = 4;
-    strncpy(frame.name, "Quadcopter (4x motor X)", 32);
-    
-    float angles[4] = {45, 135, 225, 315};
-    uint8_t reversed[4] = {1, 0, 1, 0};
-    for (uint8_t i = 0; i < 4; i++) {
-        frame.motors[i].motor_id = i;
-        frame.motors[i].angle_deg = angles[i];
-        frame.motors[i].reversed = reversed[i];
-        frame.motors[i].thrust_factor = 1.0f;
+bool MotorConfigManager::set_thrust_factor(uint8_t motor_id, float factor) {
+    if (motor_id >= MAX_MOTORS || !(factor >= THRUST_FACTOR_MIN && factor <= THRUST_FACTOR_MAX)) {
+        return false;
     }
+    thrust_factor[motor_id] = factor;
+    update_row_gains();
+    return true;
 }
 
-void MotorConfigManager::build_hexacopter_frame(FrameConfig& frame) {
-    frame.frame_type = FRAME_HEXACOPTER;
-    frame.num_motors = 6;
-    strncpy(frame.name, "Hexacopter (6x motor)", 32);
-    
-    float angles[6] = {0, 60, 120, 180, 240, 300};
-    uint8_t reversed[6] = {0, 1, 0, 1, 0, 1};
-    for (uint8_t i = 0; i < 6; i++) {
-        frame.motors[i].motor_id = i;
-        frame.motors[i].angle_deg = angles[i];
-        frame.motors[i].reversed = reversed[i];
-        frame.motors[i].thrust_factor = 1.0f;
-    }
+float MotorConfigManager::get_thrust_factor(uint8_t motor_id) const {
+    return motor_id < MAX_MOTORS ? thrust_factor[motor_id] : 1.0f;
 }
 
-void MotorConfigManager::build_octocopter_frame(FrameConfig& frame) {
-    frame.frame_type = FRAME_OCTOCOPTER;
-    frame.num_motors = 8;
-    strncpy(frame.name, "Octocopter (8x motor)", 32);
-    
-    float angles[8] = {22.5, 67.5, 112.5, 157.5, 202.5, 247.5, 292.5, 337.5};
-    uint8_t reversed[8] = {0, 1, 0, 1, 0, 1, 0, 1};
-    for (uint8_t i = 0; i < 8; i++) {
-        frame.motors[i].motor_id = i;
-        frame.motors[i].angle_deg = angles[i];
-        frame.motors[i].reversed = reversed[i];
-        frame.motors[i].thrust_factor = 1.0f;
+void MotorConfigManager::update_row_gains() {
+    for (uint8_t i = 0; i < MAX_MOTORS; i++) {
+        float gain = 1.0f / thrust_factor[i];
+        int16_t q = (int16_t)(gain * (float)(1 << ROW_GAIN_SHIFT) + 0.5f);
+        bool reversed = (reversed_mask & (1u << i)) != 0;
+        row_gain[i] = reversed ? -gain : gain;
+        row_gain_q13[i] = reversed ? (int16_t)-q : q;
     }
 }
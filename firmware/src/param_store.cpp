@@ -0,0 +1,124 @@
+#include "param_store.h"
+#include "hardware_hal.h"
+#include <cstring>
+
+// The last 256KB of the 1MB image region; linker.ld keeps code out of it
+const uint8_t ParamStore::SECTORS[2] = {10, 11};
+
+static_assert(sizeof(StoredParams) % 4 == 0, "records are programmed in words");
+
+ParamStore::ParamStore() : active(-1), next_slot(0), sequence(0) {}
+
+uint16_t ParamStore::record_crc(const Record& record) {
+    Record copy = record;
+    copy.crc = 0;
+    return crc16((const uint8_t*)&copy, sizeof(copy));
+}
+
+const ParamStore::Record* ParamStore::slot_record(uint8_t index, uint32_t slot) {
+    const uint8_t* base = FlashDriver::sector_address(SECTORS[index]);
+    return (const Record*)(base + HEADER_SIZE + slot * sizeof(Record));
+}
+
+uint32_t ParamStore::slot_count(uint8_t index) {
+    return (FlashDriver::sector_size(SECTORS[index]) - HEADER_SIZE) / sizeof(Record);
+}
+
+bool ParamStore::slot_used(uint8_t index, uint32_t slot) {
+    return slot_record(index, slot)->sequence != 0xFFFFFFFF;
+}
+
+uint32_t ParamStore::find_end(uint8_t index) {
+    uint32_t lo = 0;
+    uint32_t hi = slot_count(index);
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (slot_used(index, mid)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+const ParamStore::Record* ParamStore::newest_record(uint8_t index, uint32_t end) {
+    while (end > 0) {
+        const Record* record = slot_record(index, --end);
+        if (record->crc == record_crc(*record)) {
+            return record;
+        }
+    }
+    return nullptr;
+}
+
+bool ParamStore::load(StoredParams& params) {
+    const Record* newest = nullptr;
+    for (uint8_t i = 0; i < 2; i++) {
+        const uint32_t* header = (const uint32_t*)FlashDriver::sector_address(SECTORS[i]);
+        if (*header != SECTOR_MAGIC) continue;
+        
+        uint32_t end = find_end(i);
+        const Record* record = newest_record(i, end);
+        if (record && (!newest || record->sequence > newest->sequence)) {
+            newest = record;
+            active = (int8_t)i;
+            next_slot = end;
+        }
+    }
+    if (!newest) {
+        return false;
+    }
+    sequence = newest->sequence;
+    if (newest->length != sizeof(StoredParams)) {
+        return false;
+    }
+    memcpy(&params, &newest->params, sizeof(params));
+    return true;
+}
+
+bool ParamStore::save_needs_erase() const {
+    return active < 0 || next_slot >= slot_count((uint8_t)active);
+}
+
+bool ParamStore::save(const StoredParams& params) {
+    if (save_needs_erase()) {
+        // Start the other sector; the current one stays intact until the next switch
+        uint8_t target = active < 0 ? 0 : (uint8_t)(1 - active);
+        if (!g_flash.erase_sector(SECTORS[target])) {
+            return false;
+        }
+        uint32_t magic = SECTOR_MAGIC;
+        if (!g_flash.program(FlashDriver::sector_address(SECTORS[target]), &magic, 1)) {
+            return false;
+        }
+        active = (int8_t)target;
+        next_slot = 0;
+    }
+    
+    Record record;
+    memset(&record, 0, sizeof(record));
+    if (sequence < 0xFFFFFFFE) sequence++;
+    record.sequence = sequence;
+    record.length = sizeof(StoredParams);
+    record.params = params;
+    record.crc = record_crc(record);
+    
+    const Record* slot = slot_record((uint8_t)active, next_slot);
+    if (g_flash.program(slot, (const uint32_t*)&record, sizeof(record) / 4)) {
+        next_slot++;
+        return true;
+    }
+    
+    // A failed slot is consumed, but it must not read as empty or find_end()
+    // could stop at it. If the sequence word never landed, mark the slot with
+    // sequence 0; its CRC won't match, so load() skips it.
+    uint32_t used = 0;
+    if (slot->sequence == 0xFFFFFFFF && !g_flash.program(&slot->sequence, &used, 1)) {
+        // Can't mark it either: write nothing more past the hole in this sector
+        next_slot = slot_count((uint8_t)active);
+        return false;
+    }
+    next_slot++;
+    return false;
+}
@@ -1,4 +1,6 @@
 // Minimal startup code for ARM Cortex-M4
+#include <cstdint>
+
 extern int main(void);
 extern void _stack(void);
 
@@ -42,8 +44,13 @@ void SVC_Handler(void) __attribute__((weak, alias("Default_Handler")));
 void DebugMon_Handler(void) __attribute__((weak, alias("Default_Handler")));
 void PendSV_Handler(void) __attribute__((weak, alias("Default_Handler")));
 void SysTick_Handler(void) __attribute__((weak, alias("Default_Handler")));
+void USART1_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+
+#define DH ((uint32_t)Default_Handler)
+
+// 16 core exceptions followed by external IRQs 0..37 (USART1 is IRQ 37)
 
-uint32_t vectors[16] __attribute__((section(".vectors"))) = {
+uint32_t vectors[16 + 38] __attribute__((section(".vectors"))) = {
     (uint32_t)&_stack,
     (uint32_t)Reset_Handler,
     (uint32_t)NMI_Handler,
@@ -60,4 +67,10 @@ uint32_t vectors[16] __attribute__((section(".vectors"))) = {
     0,
     (uint32_t)PendSV_Handler,
     (uint32_t)SysTick_Handler,
+    DH, DH, DH, DH, DH, DH, DH, DH,    // IRQ 0-7
+    DH, DH, DH, DH, DH, DH, DH, DH,    // IRQ 8-15
+    DH, DH, DH, DH, DH, DH, DH, DH,    // IRQ 16-23
+    DH, DH, DH, DH, DH, DH, DH, DH,    // IRQ 24-31
+    DH, DH, DH, DH, DH,                // IRQ 32-36
+    (uint32_t)USART1_IRQHandler,       // IRQ 37
 };
@@ -0,0 +1,80 @@
+#include "task_scheduler.h"
+#include "hardware_hal.h"
+#include <cstring>
+
+TaskScheduler::TaskScheduler() {
+    init(nullptr, 0, 0);
+}
+
+void TaskScheduler::init(const TaskEntry* tasks, uint8_t count, uint32_t now_ms) {
+    table = tasks;
+    task_count = count < (uint8_t)TASK_COUNT ? count : (uint8_t)TASK_COUNT;
+    memset(state, 0, sizeof(state));
+    for (uint8_t i = 0; i < task_count; i++) {
+        state[i].next_ms = now_ms;
+    }
+    window_start_ms = now_ms;
+    memset(&timing, 0, sizeof(timing));
+}
+
+uint8_t TaskScheduler::run_pending(uint32_t now_ms) {
+    uint8_t ran = 0;
+    for (uint8_t i = 0; i < task_count; i++) {
+        const TaskEntry& task = table[i];
+        TaskState& s = state[i];
+        int32_t late = (int32_t)(now_ms - s.next_ms);
+        if (late < 0) continue;
+        
+        uint32_t start = g_clock.cycles();
+        task.run(now_ms);
+        uint32_t elapsed_us = (g_clock.cycles() - start) / SystemClock::CYCLES_PER_US;
+        
+        s.next_ms += task.period_ms;
+        bool overrun = elapsed_us > (uint32_t)task.period_ms * 1000;
+        if ((int32_t)(now_ms - s.next_ms) >= 0) {
+            s.next_ms = now_ms + task.period_ms;  // missed a release - don't burst to catch up
+            overrun = true;
+        }
+        if (overrun) s.overruns++;
+        
+        s.runs++;
+        s.total_us += elapsed_us;
+        if (elapsed_us > s.max_us) s.max_us = elapsed_us;
+        ran++;
+    }
+    update_timing(now_ms);
+    return ran;
+}
+
+void TaskScheduler::update_timing(uint32_t now_ms) {
+    uint32_t elapsed = now_ms - window_start_ms;
+    if (elapsed < TIMING_WINDOW_MS) return;
+    
+    for (uint8_t i = 0; i < task_count; i++) {
+        TaskState& s = state[i];
+        TaskTimingEntry& out = timing.tasks[i];
+        out.rate_hz = (uint16_t)(s.runs * 1000 / elapsed);
+        out.avg_us = (uint16_t)(s.runs ? s.total_us / s.runs : 0);
+        out.max_us = (uint16_t)(s.max_us < 65535 ? s.max_us : 65535);
+        out.overruns = (uint16_t)(s.overruns < 65535 ? s.overruns : 65535);
+        s.runs = 0;
+        s.total_us = 0;
+        s.max_us = 0;
+    }
+    window_start_ms = now_ms;
+}
+
+void TaskScheduler::run() {
+    uint32_t last_ms = g_clock.millis() - 1;
+    while (1) {
+        uint32_t now = g_clock.millis();
+        if (now != last_ms) {
+            last_ms = now;
+            run_pending(now);
+        }
+#if defined(__arm__)
+        // Sleep until the next SysTick or UART interrupt
+        __asm__ volatile("wfi");
+#endif
+    }
+}
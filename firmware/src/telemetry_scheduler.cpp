@@ -0,0 +1,219 @@
+#include "telemetry_scheduler.h"
+#include <cstring>
+
+// Attitude and IMU at 100Hz, depth at 50Hz, battery and slow sensors below
+// that, link and task timing once a second, config blocks only on change or request.
+const TelemetryGroupSchedule TelemetryScheduler::SCHEDULE[DELTA_GROUP_COUNT] = {
+    {DELTA_GROUP_ATTITUDE,     10, 0},
+    {DELTA_GROUP_GYRO,         10, 0},
+    {DELTA_GROUP_ACCEL,        10, 1},
+    {DELTA_GROUP_MAG,          50, 2},
+    {DELTA_GROUP_DEPTH,        20, 1},
+    {DELTA_GROUP_ENVIRONMENT, 500, 3},
+    {DELTA_GROUP_BATTERY,     200, 2},
+    {DELTA_GROUP_STATUS,      100, 1},
+    {DELTA_GROUP_LINK,       1000, 3},
+    {DELTA_GROUP_PID,           0, 4},
+    {DELTA_GROUP_CAMERA,        0, 4},
+    {DELTA_GROUP_WATER,         0, 4},
+    {DELTA_GROUP_TIMING,     1000, 3},
+};
+
+TelemetryScheduler::TelemetryScheduler() {
+    init(57600);
+}
+
+void TelemetryScheduler::init(uint32_t baudrate) {
+    memset(candidate, 0, sizeof(candidate));
+    memset(last_sent, 0, sizeof(last_sent));
+    memset(last_sent_ms, 0, sizeof(last_sent_ms));
+    requested_groups = 0;
+    selected_groups = 0;
+    keyframe_capacity_mah = 0.0f;
+    send_keyframe = false;
+    keyframe_pending = true;
+    last_keyframe_ms = 0;
+    
+    // 8N1: 10 bits on the wire per byte
+    bytes_per_second = baudrate / 10 * BUDGET_PERCENT / 100;
+    budget = TELEMETRY_PACKET_SIZE;
+    budget_ms = 0;
+    
+    poll_ms = 0;
+    window_start_ms = 0;
+    window_bytes = 0;
+    window_deferred = 0;
+    memset(&link, 0, sizeof(link));
+    link.capacity_bytes_per_s = (uint16_t)(baudrate / 10);
+}
+
+void TelemetryScheduler::request_config() {
+    requested_groups |= (1u << DELTA_GROUP_PID) | (1u << DELTA_GROUP_CAMERA) | (1u << DELTA_GROUP_WATER);
+}
+
+bool TelemetryScheduler::reserve(uint16_t bytes, uint32_t now_ms) {
+    refill_budget(now_ms);
+    if (budget < (int32_t)bytes) return false;
+    budget -= bytes;
+    window_bytes += bytes;
+    return true;
+}
+
+void TelemetryScheduler::refill_budget(uint32_t now_ms) {
+    uint32_t elapsed = now_ms - budget_ms;
+    if (elapsed == 0) return;
+    budget_ms = now_ms;
+    
+    int32_t refill = (int32_t)((uint64_t)elapsed * bytes_per_second / 1000);
+    budget += refill;
+    // Burst cap: enough for one keyframe, no more
+    if (budget > TELEMETRY_PACKET_SIZE) budget = TELEMETRY_PACKET_SIZE;
+}
+
+void TelemetryScheduler::update_utilization(uint32_t now_ms) {
+    uint32_t elapsed = now_ms - window_start_ms;
+    if (elapsed < UTILIZATION_WINDOW_MS) return;
+    
+    link.tx_bytes_per_s = (uint16_t)(window_bytes * 1000 / elapsed);
+    link.deferred_per_s = (uint16_t)(window_deferred * 1000 / elapsed);
+    window_start_ms = now_ms;
+    window_bytes = 0;
+    window_deferred = 0;
+}
+
+bool TelemetryScheduler::group_due(const TelemetryGroupSchedule& entry, uint32_t now_ms) const {
+    uint8_t g = entry.group;
+    if (requested_groups & (1u << g)) return true;
+    
+    bool changed = memcmp(candidate[g], last_sent[g], DELTA_GROUP_SIZES[g]) != 0;
+    if (entry.period_ms == 0) return changed;
+    
+    // Slots are aligned to multiples of the period rather than to the last send,
+    // so groups sharing a period (or a multiple of it) stay in the same frame even
+    // after a send was held back a tick.
+    if (now_ms / entry.period_ms == last_sent_ms[g] / entry.period_ms) return false;
+    return changed || now_ms - last_sent_ms[g] >= REFRESH_MS;
+}
+
+bool TelemetryScheduler::poll(const RobotState& state, uint32_t now_ms) {
+    poll_ms = now_ms;
+    refill_budget(now_ms);
+    update_utilization(now_ms);
+    selected_groups = 0;
+    send_keyframe = false;
+    
+    // Battery capacity has no group of its own
+    if (memcmp(&state.battery.capacity_mah, &keyframe_capacity_mah, sizeof(float)) != 0) {
+        keyframe_pending = true;
+    }
+    
+    uint32_t since_keyframe = now_ms - last_keyframe_ms;
+    bool keyframe_due = since_keyframe >= KEYFRAME_INTERVAL_MS ||
+                        (keyframe_pending && since_keyframe >= KEYFRAME_MIN_INTERVAL_MS);
+    if (keyframe_due || (keyframe_pending && last_keyframe_ms == 0)) {
+        if (budget < TELEMETRY_PACKET_SIZE) {
+            return false;  // wait for the bucket to fill rather than starve the keyframe
+        }
+        for (uint8_t g = 0; g < DELTA_GROUP_COUNT; g++) {
+            telemetry_delta_write_group(g, state, candidate[g]);
+        }
+        send_keyframe = true;
+        return true;
+    }
+    
+    for (uint8_t g = 0; g < DELTA_GROUP_COUNT; g++) {
+        telemetry_delta_write_group(g, state, candidate[g]);
+    }
+    
+    uint16_t due_groups = 0;
+    int32_t needed = TELEMETRY_DELTA_MIN_SIZE;
+    bool starving = false;
+    for (uint8_t i = 0; i < DELTA_GROUP_COUNT; i++) {
+        const TelemetryGroupSchedule& entry = SCHEDULE[i];
+        if (!group_due(entry, now_ms)) continue;
+        due_groups |= (uint16_t)(1u << entry.group);
+        needed += DELTA_GROUP_SIZES[entry.group];
+        if (entry.period_ms > 0 && now_ms - last_sent_ms[entry.group] >= 2u * entry.period_ms) {
+            starving = true;
+        }
+    }
+    if (due_groups == 0) return false;
+    
+    if (needed <= budget) {
+        selected_groups = due_groups;
+        return true;
+    }
+    // Short on budget: wait for it to refill rather than splitting the due groups
+    // across several small frames, each paying for its own header - unless a group
+    // has already missed a whole period. Then pack by priority and defer the rest.
+    if (!starving) return false;
+    
+    int32_t frame_size = TELEMETRY_DELTA_MIN_SIZE;
+    for (uint8_t priority = 0; priority <= LOWEST_PRIORITY; priority++) {
+        for (uint8_t i = 0; i < DELTA_GROUP_COUNT; i++) {
+            const TelemetryGroupSchedule& entry = SCHEDULE[i];
+            if (entry.priority != priority || !(due_groups & (1u << entry.group))) continue;
+            
+            int32_t size = DELTA_GROUP_SIZES[entry.group];
+            if (frame_size + size > budget) {
+                window_deferred++;
+                continue;
+            }
+            frame_size += size;
+            selected_groups |= (uint16_t)(1u << entry.group);
+        }
+    }
+    return selected_groups != 0;
+}
+
+uint16_t TelemetryScheduler::encode(const TelemetryPacket& packet, uint8_t* out, uint16_t capacity) {
+    if (send_keyframe) {
+        if (capacity < TELEMETRY_PACKET_SIZE) return 0;
+        // The receiver now holds every field
+        for (uint8_t g = 0; g < DELTA_GROUP_COUNT; g++) {
+            memcpy(last_sent[g], candidate[g], DELTA_GROUP_SIZES[g]);
+            last_sent_ms[g] = poll_ms;
+        }
+        requested_groups = 0;
+        keyframe_capacity_mah = packet.state.battery.capacity_mah;
+        keyframe_pending = false;
+        last_keyframe_ms = poll_ms;
+        send_keyframe = false;
+        
+        uint16_t len = encode_telemetry_packet(packet, out);
+        budget -= len;
+        window_bytes += len;
+        return len;
+    }
+    
+    if (selected_groups == 0 || capacity < TELEMETRY_DELTA_MAX_SIZE) return 0;
+    
+    uint8_t* payload = out + TELEMETRY_DELTA_HEADER_SIZE;
+    uint16_t len = TELEMETRY_DELTA_HEADER_SIZE;
+    for (uint8_t g = 0; g < DELTA_GROUP_COUNT; g++) {
+        if (!(selected_groups & (1u << g))) continue;
+        uint8_t size = DELTA_GROUP_SIZES[g];
+        memcpy(payload, candidate[g], size);
+        memcpy(last_sent[g], candidate[g], size);
+        last_sent_ms[g] = poll_ms;
+        payload += size;
+        len += size;
+    }
+    len += 2;
+    requested_groups &= (uint16_t)~selected_groups;
+    
+    TelemetryDeltaHeader header;
+    header.packet_type = PACKET_TYPE_TELEMETRY_DELTA;
+    header.length = (uint8_t)len;
+    header.sequence = packet.sequence;
+    header.timestamp_ms = packet.timestamp_ms;
+    header.control_echo = packet.control_echo;
+    header.groups = selected_groups;
+    memcpy(out, &header, TELEMETRY_DELTA_HEADER_SIZE);
+    wire_put_u16(out + len - 2, crc16(out, len - 2));
+    
+    selected_groups = 0;
+    budget -= len;
+    window_bytes += len;
+    return len;
+}
@@ -0,0 +1,43 @@
+#include "thrust_allocator.h"
+#include <cmath>
+
+void ThrustAllocator::allocate(const float* wrench, float* thrust, const float* row_gain) const {
+    if (!active) return;
+    const uint8_t num_motors = active->num_motors;
+    const float (*mix)[AXIS_COUNT] = active->mix;
+    float attitude[MAX_MOTORS];
+    float translation[MAX_MOTORS];
+    float peak = 0.0f;
+    for (uint8_t i = 0; i < num_motors; i++) {
+        const float* row = mix[i];
+        attitude[i] = row[AXIS_ROLL] * wrench[AXIS_ROLL] + row[AXIS_PITCH] * wrench[AXIS_PITCH] +
+                      row[AXIS_YAW] * wrench[AXIS_YAW];
+        translation[i] = row[AXIS_SURGE] * wrench[AXIS_SURGE] + row[AXIS_SWAY] * wrench[AXIS_SWAY] +
+                         row[AXIS_HEAVE] * wrench[AXIS_HEAVE];
+        if (row_gain) {
+            attitude[i] *= row_gain[i];
+            translation[i] *= row_gain[i];
+        }
+        float a = fabsf(attitude[i]);
+        if (a > peak) peak = a;
+    }
+    
+    float attitude_scale = peak > 1.0f ? 1.0f / peak : 1.0f;
+    float translation_scale = 1.0f;
+    for (uint8_t i = 0; i < num_motors; i++) {
+        attitude[i] *= attitude_scale;
+        float t = translation[i];
+        if (t > 0.0f) {
+            float room = (1.0f - attitude[i]) / t;
+            if (room < translation_scale) translation_scale = room;
+        } else if (t < 0.0f) {
+            float room = (-1.0f - attitude[i]) / t;
+            if (room < translation_scale) translation_scale = room;
+        }
+    }
+    if (translation_scale < 0.0f) translation_scale = 0.0f;
+    
+    for (uint8_t i = 0; i < num_motors; i++) {
+        thrust[i] = attitude[i] + translation_scale * translation[i];
+    }
+}
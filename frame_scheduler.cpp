@@ -0,0 +1,122 @@
+#include "frame_scheduler.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+FrameScheduler::FrameScheduler(int max_fps, int idle_redraw_ms)
+    : m_min_interval_us(max_fps > 0 ? 1000000 / (uint64_t)max_fps : 0),
+      m_idle_interval_us((uint64_t)idle_redraw_ms * 1000),
+      m_pending(REDRAW_IDLE), m_animation_frames(0), m_last_draw_us(0), m_drawing(0),
+      m_visible(true),
+      m_frame_begin_us(0), m_frame_begin_cpu_us(0), m_count(0), m_next(0),
+      m_frames(0), m_wakeups(0) {
+    memset(m_begin_us, 0, sizeof(m_begin_us));
+    memset(m_frame_ms, 0, sizeof(m_frame_ms));
+    memset(m_cpu_ms, 0, sizeof(m_cpu_ms));
+    memset(m_reasons, 0, sizeof(m_reasons));
+}
+
+void FrameScheduler::animate_for(int frames) {
+    m_animation_frames = std::max(m_animation_frames, frames);
+}
+
+bool FrameScheduler::should_draw(uint64_t now_us) {
+    if (!m_visible) {
+        return false;
+    }
+    if (m_animation_frames > 0) {
+        m_pending |= REDRAW_ANIMATION;
+    }
+    if (m_idle_interval_us > 0 && now_us - m_last_draw_us >= m_idle_interval_us) {
+        m_pending |= REDRAW_IDLE;
+    }
+    if (m_pending == 0) {
+        return false;
+    }
+    return now_us - m_last_draw_us >= m_min_interval_us;
+}
+
+int FrameScheduler::wait_timeout_ms(uint64_t now_us, uint64_t next_timer_us) const {
+    uint64_t wake_us = next_timer_us;
+    if (!m_visible) {
+        // Nothing can be drawn; only timers and events (a restore is one) wake the loop
+    } else if (m_pending != 0 || m_animation_frames > 0) {
+        // Something is waiting to be drawn; sleep out the rest of the frame interval only
+        wake_us = std::min(wake_us, m_last_draw_us + m_min_interval_us);
+    } else if (m_idle_interval_us > 0) {
+        wake_us = std::min(wake_us, m_last_draw_us + m_idle_interval_us);
+    }
+    if (wake_us <= now_us) {
+        return 0;
+    }
+    // Round up so the loop doesn't wake a fraction of a millisecond early and spin
+    return (int)std::min<uint64_t>((wake_us - now_us + 999) / 1000, 1000);
+}
+
+uint64_t FrameScheduler::thread_cpu_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+void FrameScheduler::begin_frame(uint64_t now_us) {
+    m_drawing = m_pending;
+    m_pending = 0;
+    if (m_animation_frames > 0) {
+        m_animation_frames--;
+    }
+    m_last_draw_us = now_us;
+    m_frame_begin_us = now_us;
+    m_frame_begin_cpu_us = thread_cpu_us();
+}
+
+void FrameScheduler::end_frame(uint64_t now_us) {
+    m_begin_us[m_next] = m_frame_begin_us;
+    m_frame_ms[m_next] = (float)(now_us - m_frame_begin_us) / 1000.0f;
+    m_cpu_ms[m_next] = (float)(thread_cpu_us() - m_frame_begin_cpu_us) / 1000.0f;
+    m_next = (m_next + 1) % WINDOW;
+    if (m_count < WINDOW) {
+        m_count++;
+    }
+    m_frames++;
+    for (int bit = 0; bit < 5; bit++) {
+        if (m_drawing & (1u << bit)) {
+            m_reasons[bit]++;
+        }
+    }
+}
+
+void FrameScheduler::snapshot(FrameStatsSnapshot& out) const {
+    memset(&out, 0, sizeof(out));
+    out.frames = m_frames;
+    out.wakeups = m_wakeups;
+    memcpy(out.reasons, m_reasons, sizeof(out.reasons));
+    if (m_count == 0) {
+        return;
+    }
+
+    uint64_t first_us = m_begin_us[0];
+    uint64_t last_us = first_us;
+    float cpu_total = 0.0f;
+    float frame_sorted[WINDOW];
+    float cpu_sorted[WINDOW];
+    for (uint32_t i = 0; i < m_count; i++) {
+        first_us = std::min(first_us, m_begin_us[i]);
+        last_us = std::max(last_us, m_begin_us[i]);
+        frame_sorted[i] = m_frame_ms[i];
+        cpu_sorted[i] = m_cpu_ms[i];
+        cpu_total += m_cpu_ms[i];
+    }
+    if (last_us > first_us) {
+        out.fps = (float)(m_count - 1) * 1e6f / (float)(last_us - first_us);
+    }
+
+    std::sort(frame_sorted, frame_sorted + m_count);
+    std::sort(cpu_sorted, cpu_sorted + m_count);
+    out.frame_p50_ms = frame_sorted[(m_count - 1) * 50 / 100];
+    out.frame_p95_ms = frame_sorted[(m_count - 1) * 95 / 100];
+    out.frame_p99_ms = frame_sorted[(m_count - 1) * 99 / 100];
+    out.frame_max_ms = frame_sorted[m_count - 1];
+    out.cpu_avg_ms = cpu_total / (float)m_count;
+    out.cpu_p95_ms = cpu_sorted[(m_count - 1) * 95 / 100];
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+// Why the UI needs another frame
+enum RedrawReason {
+    REDRAW_INPUT     = 0x01,
+    REDRAW_VIDEO     = 0x02,
+    REDRAW_TELEMETRY = 0x04,
+    REDRAW_ANIMATION = 0x08,
+    REDRAW_IDLE      = 0x10
+};
+
+// Fixed-period timer driven by the main loop's clock (microseconds)
+struct PeriodicTimer {
+    uint64_t period_us;
+    uint64_t next_us;
+
+    explicit PeriodicTimer(uint32_t period_ms) : period_us((uint64_t)period_ms * 1000), next_us(0) {}
+
+    // True once per period; skips missed periods instead of firing a burst
+    bool due(uint64_t now_us) {
+        if (now_us < next_us) return false;
+        next_us += period_us;
+        if (next_us <= now_us) next_us = now_us + period_us;
+        return true;
+    }
+};
+
+// Render-loop figures over the most recent FrameScheduler::WINDOW drawn frames
+struct FrameStatsSnapshot {
+    uint32_t frames;            // drawn since start
+    uint32_t wakeups;           // main loop iterations since start
+    float fps;                  // achieved draw rate over the window
+    float frame_p50_ms;         // begin_frame -> end_frame (build, render, present)
+    float frame_p95_ms;
+    float frame_p99_ms;
+    float frame_max_ms;
+    float cpu_avg_ms;           // main-thread CPU time per drawn frame
+    float cpu_p95_ms;
+    uint32_t reasons[5];        // frames drawn per RedrawReason bit, since start
+};
+
+// Decides when the main loop redraws. A frame is drawn only when something
+// asked for one (input, a new video frame, new telemetry, a settling ImGui
+// animation) and not faster than max_fps; otherwise the loop sleeps in
+// SDL_WaitEventTimeout until the next event or timer. An idle redraw every
+// idle_redraw_ms keeps status text fresh. While the window is hidden nothing
+// can be drawn, so requests stay pending and the loop only wakes for timers
+// and events. Not thread-safe; the main loop owns it.
+class FrameScheduler {
+public:
+    FrameScheduler(int max_fps, int idle_redraw_ms);
+
+    void request(uint32_t reasons) { m_pending |= reasons; }
+
+    // Minimized or hidden windows can't draw; pending requests then don't shorten the wait
+    void set_visible(bool visible) { m_visible = visible; }
+
+    // Keep drawing for a few frames, e.g. so ImGui can settle hover and focus after input
+    void animate_for(int frames);
+
+    // Is a frame requested and the minimum frame interval over?
+    bool should_draw(uint64_t now_us);
+
+    // How long the loop may sleep before it has to draw or service a timer due at next_timer_us
+    int wait_timeout_ms(uint64_t now_us, uint64_t next_timer_us) const;
+
+    void on_wakeup() { m_wakeups++; }
+    void begin_frame(uint64_t now_us);
+    void end_frame(uint64_t now_us);
+
+    void snapshot(FrameStatsSnapshot& out) const;
+
+    static const uint32_t WINDOW = 256;  // frames
+
+private:
+    static uint64_t thread_cpu_us();
+
+    uint64_t m_min_interval_us;
+    uint64_t m_idle_interval_us;
+    uint32_t m_pending;
+    int m_animation_frames;
+    uint64_t m_last_draw_us;
+    uint32_t m_drawing;          // reasons for the frame in progress
+    bool m_visible;
+
+    uint64_t m_frame_begin_us;
+    uint64_t m_frame_begin_cpu_us;
+    uint64_t m_begin_us[WINDOW];
+    float m_frame_ms[WINDOW];
+    float m_cpu_ms[WINDOW];
+    uint32_t m_count;
+    uint32_t m_next;
+    uint32_t m_frames;
+    uint32_t m_wakeups;
+    uint32_t m_reasons[5];
+};
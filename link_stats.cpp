@@ -0,0 +1,133 @@
+#include "link_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+LinkStats::LinkStats() {
+    reset();
+}
+
+void LinkStats::reset() {
+    memset(m_arrivals, 0, sizeof(m_arrivals));
+    m_arrival_count = 0;
+    m_arrival_next = 0;
+    memset(m_sent, 0, sizeof(m_sent));
+    memset(m_rtt_ms, 0, sizeof(m_rtt_ms));
+    m_rtt_count = 0;
+    m_rtt_next = 0;
+    m_have_echo = false;
+    m_last_echo = 0;
+    m_have_sequence = false;
+    m_highest_sequence = 0;
+    m_reordered = 0;
+    m_duplicates = 0;
+    m_have_transit = false;
+    m_last_transit_ms = 0.0;
+    m_jitter_ms = 0.0;
+}
+
+void LinkStats::on_control_sent(uint16_t sequence, uint64_t now_us) {
+    Sent& slot = m_sent[sequence % SENT_HISTORY];
+    slot.sequence = sequence;
+    slot.valid = true;
+    slot.time_us = now_us;
+}
+
+bool LinkStats::seen_in_window(int64_t sequence) const {
+    for (uint32_t i = 0; i < m_arrival_count; i++) {
+        if (m_arrivals[i].sequence == sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LinkStats::on_telemetry(uint16_t sequence, uint32_t remote_timestamp_ms, uint16_t control_echo, uint64_t now_us) {
+    // Unwrap the 16-bit sequence relative to the highest one seen so far
+    int64_t unwrapped = sequence;
+    if (m_have_sequence) {
+        int16_t delta = (int16_t)(uint16_t)(sequence - (uint16_t)m_highest_sequence);
+        unwrapped = m_highest_sequence + delta;
+    }
+
+    if (m_have_sequence && unwrapped <= m_highest_sequence) {
+        if (seen_in_window(unwrapped)) {
+            m_duplicates++;
+            return;
+        }
+        m_reordered++;
+    } else {
+        m_highest_sequence = unwrapped;
+        m_have_sequence = true;
+    }
+
+    m_arrivals[m_arrival_next].sequence = unwrapped;
+    m_arrivals[m_arrival_next].time_us = now_us;
+    m_arrival_next = (m_arrival_next + 1) % WINDOW;
+    if (m_arrival_count < WINDOW) {
+        m_arrival_count++;
+    }
+
+    // Jitter: J += (|D| - J) / 16, D = difference in transit time between consecutive packets
+    double transit_ms = (double)now_us / 1000.0 - (double)remote_timestamp_ms;
+    if (m_have_transit) {
+        double d = std::fabs(transit_ms - m_last_transit_ms);
+        m_jitter_ms += (d - m_jitter_ms) / 16.0;
+    }
+    m_last_transit_ms = transit_ms;
+    m_have_transit = true;
+
+    // One RTT sample per new echo. Telemetry sent before the next control packet
+    // arrives repeats the same echo and must not be counted again.
+    if (m_have_echo && control_echo == m_last_echo) {
+        return;
+    }
+    m_have_echo = true;
+    m_last_echo = control_echo;
+
+    const Sent& sent = m_sent[control_echo % SENT_HISTORY];
+    if (sent.valid && sent.sequence == control_echo && now_us >= sent.time_us) {
+        m_rtt_ms[m_rtt_next] = (float)(now_us - sent.time_us) / 1000.0f;
+        m_rtt_next = (m_rtt_next + 1) % RTT_WINDOW;
+        if (m_rtt_count < RTT_WINDOW) {
+            m_rtt_count++;
+        }
+    }
+}
+
+void LinkStats::snapshot(LinkStatsSnapshot& out) const {
+    memset(&out, 0, sizeof(out));
+    out.reordered = m_reordered;
+    out.duplicates = m_duplicates;
+    out.jitter_ms = (float)m_jitter_ms;
+
+    if (m_arrival_count > 0) {
+        int64_t lowest = m_highest_sequence;
+        uint64_t first_us = m_arrivals[0].time_us;
+        uint64_t last_us = first_us;
+        for (uint32_t i = 0; i < m_arrival_count; i++) {
+            lowest = std::min(lowest, m_arrivals[i].sequence);
+            first_us = std::min(first_us, m_arrivals[i].time_us);
+            last_us = std::max(last_us, m_arrivals[i].time_us);
+        }
+        out.received = m_arrival_count;
+        out.expected = (uint32_t)(m_highest_sequence - lowest + 1);
+        if (out.expected > out.received) {
+            out.loss_rate = (float)(out.expected - out.received) / (float)out.expected;
+        }
+        if (last_us > first_us) {
+            out.rate_hz = (float)(m_arrival_count - 1) * 1e6f / (float)(last_us - first_us);
+        }
+    }
+
+    if (m_rtt_count > 0) {
+        float sorted[RTT_WINDOW];
+        memcpy(sorted, m_rtt_ms, m_rtt_count * sizeof(float));
+        std::sort(sorted, sorted + m_rtt_count);
+        out.rtt_samples = m_rtt_count;
+        out.rtt_p50_ms = sorted[(m_rtt_count - 1) * 50 / 100];
+        out.rtt_p95_ms = sorted[(m_rtt_count - 1) * 95 / 100];
+        out.rtt_p99_ms = sorted[(m_rtt_count - 1) * 99 / 100];
+        out.rtt_max_ms = sorted[m_rtt_count - 1];
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+// Link-quality figures over the most recent LinkStats::WINDOW telemetry packets
+struct LinkStatsSnapshot {
+    uint32_t received;         // telemetry packets in the window
+    uint32_t expected;         // sequence span covered by the window
+    float loss_rate;           // 0..1, from sequence gaps
+    uint32_t reordered;        // arrived after a higher sequence (since reset)
+    uint32_t duplicates;       // sequence already seen in the window (since reset)
+    float rate_hz;             // telemetry arrival rate
+    uint32_t rtt_samples;
+    float rtt_p50_ms;          // control send -> telemetry echoing that sequence
+    float rtt_p95_ms;
+    float rtt_p99_ms;
+    float rtt_max_ms;
+    float jitter_ms;           // RFC 3550 inter-arrival jitter against the firmware timestamps
+};
+
+// Tracks telemetry sequence numbers, timestamps and control echoes to measure
+// loss, reordering, round-trip time and jitter. Not thread-safe; the transport
+// thread owns it and publishes snapshots.
+class LinkStats {
+public:
+    LinkStats();
+
+    void reset();
+
+    // Record the local send time of a control packet
+    void on_control_sent(uint16_t sequence, uint64_t now_us);
+
+    // Record a received telemetry packet
+    void on_telemetry(uint16_t sequence, uint32_t remote_timestamp_ms, uint16_t control_echo, uint64_t now_us);
+
+    // Compute the current figures (sorts the RTT window)
+    void snapshot(LinkStatsSnapshot& out) const;
+
+    static const uint32_t WINDOW = 256;      // telemetry packets
+    static const uint32_t RTT_WINDOW = 128;  // RTT samples
+    static const uint32_t SENT_HISTORY = 256;  // control send times kept for echo lookup
+
+private:
+    struct Arrival {
+        int64_t sequence;      // unwrapped
+        uint64_t time_us;
+    };
+
+    struct Sent {
+        uint16_t sequence;
+        bool valid;
+        uint64_t time_us;
+    };
+
+    bool seen_in_window(int64_t sequence) const;
+
+    Arrival m_arrivals[WINDOW];
+    uint32_t m_arrival_count;
+    uint32_t m_arrival_next;
+
+    Sent m_sent[SENT_HISTORY];
+
+    float m_rtt_ms[RTT_WINDOW];
+    uint32_t m_rtt_count;
+    uint32_t m_rtt_next;
+    bool m_have_echo;
+    uint16_t m_last_echo;
+
+    bool m_have_sequence;
+    int64_t m_highest_sequence;
+    uint32_t m_reordered;
+    uint32_t m_duplicates;
+
+    bool m_have_transit;
+    double m_last_transit_ms;
+    double m_jitter_ms;
+};
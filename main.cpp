@@ -1,12 +1,77 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <SDL2/SDL.h>
 
+#include "frame_scheduler.h"
 #include "input.h"
+#include "transport_thread.h"
 #include "video.h"
 #include "ui.h"
 
-int main(int, char**)
+static const int MAX_CAMERAS = 4;
+static const int MAX_FPS = 60;
+static const int IDLE_REDRAW_MS = 250;      // keeps status text fresh while nothing else changes
+static const int TELEMETRY_POLL_MS = 50;    // telemetry is drained and redrawn at most 20 Hz
+static const int SETTLE_FRAMES = 3;         // frames ImGui gets after input to settle hover/focus
+
+// Other threads wake the main loop with one coalesced SDL user event
+static Uint32 g_wake_event = (Uint32)-1;
+static std::atomic<bool> g_wake_pending{false};
+static std::atomic<bool> g_window_visible{true};  // new video frames only matter while drawable
+
+static void wake_main_loop()
+{
+    if (!g_window_visible.load(std::memory_order_relaxed)) return;
+    if (g_wake_event == (Uint32)-1 || g_wake_pending.exchange(true)) return;
+    SDL_Event e;
+    std::memset(&e, 0, sizeof(e));
+    e.type = g_wake_event;
+    SDL_PushEvent(&e);
+}
+
+static uint64_t now_us()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+int main(int argc, char** argv)
 {
+    // --camera <url>: add a camera (repeatable; the first one is the main camera)
+    // --latency: record per-frame video pipeline timestamps
+    // --latency-source <url>: also measure glass-to-glass against a source-clock test stream
+    // --vsync: pace presents to the display instead of the frame scheduler's cap
+    const char *camera_urls[MAX_CAMERAS];
+    int camera_count = 0;
+    bool instrument_video = false;
+    bool source_clock = false;
+    bool vsync = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--vsync") == 0) {
+            vsync = true;
+        } else if (std::strcmp(argv[i], "--camera") == 0 && i + 1 < argc) {
+            if (camera_count < MAX_CAMERAS) camera_urls[camera_count++] = argv[i + 1];
+            i++;
+        } else if (std::strcmp(argv[i], "--latency") == 0) {
+            instrument_video = true;
+        } else if (std::strcmp(argv[i], "--latency-source") == 0 && i + 1 < argc) {
+            instrument_video = true;
+            source_clock = true;
+            camera_urls[0] = argv[++i];
+            camera_count = 1;
+        }
+    }
+    if (camera_count == 0) {
+        // Main camera plus the downward/gripper camera
+        camera_urls[camera_count++] = "rtsp://192.168.1.2:8554/cam";
+        camera_urls[camera_count++] = "rtsp://192.168.1.2:8554/cam2";
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER | SDL_INIT_TIMER) != 0) {
         std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
         return 1;
@@ -24,9 +89,11 @@ int main(int, char**)
         return 1;
     }
 
+    // No vsync by default: the frame scheduler decides when to draw, and a
+    // blocking present would hold up input and video uploads until the next vblank
     SDL_Renderer *renderer = SDL_CreateRenderer(
         window, -1,
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
+        SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0)
     );
     if (!renderer) {
         std::fprintf(stderr, "SDL_CreateRenderer failed: %s\n", SDL_GetError());
@@ -37,39 +104,101 @@ int main(int, char**)
 
     ui_init(window, renderer);
     input_init();
+    g_wake_event = SDL_RegisterEvents(1);
+
+    // Initialize video in background threads to avoid blocking window rendering.
+    // Low-latency profile: no demuxer buffering, minimal probing, slice-threaded decode.
+    // The scheduler splits the decoder thread budget between the cameras.
+    VideoScheduler video_scheduler;
+    VideoStream *cameras[MAX_CAMERAS];
+    for (int i = 0; i < camera_count; i++) {
+        char name[32];
+        if (i == 0) std::snprintf(name, sizeof(name), "Main");
+        else        std::snprintf(name, sizeof(name), "Camera %d", i + 1);
+        cameras[i] = new VideoStream(name, video_scheduler);
 
-    // Initialize video in background thread to avoid blocking window rendering
-    video_init_async("rtsp://192.168.1.2:8554/cam", renderer);
+        VideoOptions video_options;
+        video_options.low_latency = true;
+        video_options.udp_transport = false;
+        video_options.decode_threads = 0;
+        video_options.frame_threads = false;
+        video_options.instrument = instrument_video;
+        video_options.source_clock = source_clock;
+        cameras[i]->set_frame_callback(wake_main_loop);
+        cameras[i]->open_async(camera_urls[i], renderer, video_options);
+    }
+    ui_set_video_streams(cameras, camera_count, &video_scheduler);
+
+    // Draw only when something changed; sleep in SDL_WaitEventTimeout otherwise.
+    // Controller sampling and telemetry draining run on their own timers.
+    FrameScheduler frames(MAX_FPS, IDLE_REDRAW_MS);
+    PeriodicTimer control_timer(TransportThread::CONTROL_PERIOD_MS);
+    PeriodicTimer telemetry_timer(TELEMETRY_POLL_MS);
+    ui_set_frame_scheduler(&frames);
 
     bool running = true;
-    uint32_t last_control_send = 0;
     
     while (running) {
+        // Nothing is visible while minimized: keep timers running, but don't draw,
+        // don't wake for video and let the decoders drop to keyframes only
+        bool visible = !(SDL_GetWindowFlags(window) & (SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN));
+        if (!visible && g_window_visible.load(std::memory_order_relaxed)) {
+            for (int i = 0; i < camera_count; i++) {
+                cameras[i]->set_visibility(VIDEO_HIDDEN);
+            }
+        }
+        g_window_visible.store(visible, std::memory_order_relaxed);
+        frames.set_visible(visible);
+
+        // Timers only matter while a vehicle is connected; otherwise the loop can idle
+        bool linked = ui_is_connected_to_pixhawk();
+        uint64_t now = now_us();
+        uint64_t next_timer = linked ? std::min(control_timer.next_us, telemetry_timer.next_us) : UINT64_MAX;
+
         SDL_Event e;
-        while (SDL_PollEvent(&e)) {
-            ui_process_event(e);
-            if (e.type == SDL_QUIT) running = false;
-            input_handle_event(e);
+        if (SDL_WaitEventTimeout(&e, frames.wait_timeout_ms(now, next_timer))) {
+            do {
+                if (e.type == g_wake_event) {
+                    g_wake_pending = false;
+                    continue;
+                }
+                ui_process_event(e);
+                if (e.type == SDL_QUIT) running = false;
+                input_handle_event(e);
+                frames.request(REDRAW_INPUT);
+                frames.animate_for(SETTLE_FRAMES);
+            } while (SDL_PollEvent(&e));
         }
+        frames.on_wakeup();
+        now = now_us();
 
+        if (linked && control_timer.due(now)) {
+            // Publish the latest control state; the transport thread sends it at 50Hz
+            input_update();
+            ui_send_control_packet(input_get_state());
+        }
+        if (linked && telemetry_timer.due(now) && ui_receive_telemetry()) {
+            frames.request(REDRAW_TELEMETRY);
+        }
+        if (ui_poll_link_status()) {
+            frames.request(REDRAW_TELEMETRY);
+        }
+        if (!visible) continue;
+        for (int i = 0; i < camera_count; i++) {
+            if (cameras[i]->has_new_frame()) frames.request(REDRAW_VIDEO);
+        }
+        if (!frames.should_draw(now)) continue;
+
+        frames.begin_frame(now);
         input_update();
-        video_update();
-        
-        // Receive telemetry updates from Pixhawk
-        ui_receive_telemetry();
+        for (int i = 0; i < camera_count; i++) {
+            cameras[i]->update();
+        }
 
         ui_new_frame();
 
         const ControllerState &st = input_get_state();
-        SDL_Texture *tex = video_get_texture();
-        ui_draw(st, tex);
-        
-        // Send control packets at ~50Hz to the Pixhawk
-        uint32_t now = SDL_GetTicks();
-        if (now - last_control_send >= 20) {  // 20ms = ~50Hz
-            ui_send_control_packet(st);
-            last_control_send = now;
-        }
+        ui_draw(st);
 
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
@@ -77,9 +206,15 @@ int main(int, char**)
         ui_render();
 
         SDL_RenderPresent(renderer);
+        for (int i = 0; i < camera_count; i++) {
+            cameras[i]->on_present();
+        }
+        frames.end_frame(now_us());
     }
 
-    video_shutdown();
+    for (int i = 0; i < camera_count; i++) {
+        delete cameras[i];
+    }
     ui_shutdown();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
@@ -1,35 +1,195 @@
 #include "telemetry_parser.h"
 #include <cstring>
 
-TelemetryParser::TelemetryParser() {}
+TelemetryParser::TelemetryParser() : m_have_keyframe(false) {
+    memset(&m_state, 0, sizeof(m_state));
+}
 
 bool TelemetryParser::parse_packet(const uint8_t* data, uint16_t len, TelemetryPacket& packet) {
-    // Telemetry packets should be exactly sizeof(TelemetryPacket) bytes
-    if (len < sizeof(TelemetryPacket)) {
+    // Checks length, packet type (type 2) and CRC-16
+    if (!decode_telemetry_packet(data, len, packet)) {
+        return false;
+    }
+    m_state = packet.state;
+    m_have_keyframe = true;
+    return true;
+}
+
+bool TelemetryParser::parse_delta_packet(const uint8_t* data, uint16_t len, TelemetryPacket& packet) {
+    TelemetryDeltaHeader header;
+    if (!decode_telemetry_delta_header(data, len, header)) {
+        return false;
+    }
+    return apply_delta(header, data + TELEMETRY_DELTA_HEADER_SIZE, packet);
+}
+
+bool TelemetryParser::apply_delta(const TelemetryDeltaHeader& header, const uint8_t* payload, TelemetryPacket& packet) {
+    if (!m_have_keyframe) {
         return false;
     }
     
-    // Check packet type
-    if (data[0] != 2) {
-        return false;  // Not a telemetry packet (type 2)
+    for (uint8_t g = 0; g < DELTA_GROUP_COUNT; g++) {
+        if (header.groups & (1u << g)) {
+            payload += telemetry_delta_read_group(g, payload, m_state);
+        }
     }
     
-    memcpy(&packet, data, sizeof(TelemetryPacket));
+    packet.packet_type = PACKET_TYPE_TELEMETRY;
+    packet.sequence = header.sequence;
+    packet.timestamp_ms = header.timestamp_ms;
+    packet.control_echo = header.control_echo;
+    packet.state = m_state;
+    packet.crc = 0;
+    return true;
+}
+
+// ============== Telemetry Framer ==============
+TelemetryFramer::TelemetryFramer() {
+    reset();
+}
+
+void TelemetryFramer::reset() {
+    m_read = 0;
+    m_write = 0;
+    m_synced = false;
+    m_parser.reset();
+    m_param_read = 0;
+    m_param_write = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void TelemetryFramer::feed(const uint8_t* data, uint16_t len) {
+    // Only the newest RING_SIZE bytes can be kept
+    if (len > RING_SIZE) {
+        m_stats.bytes_discarded += len - RING_SIZE;
+        data += len - RING_SIZE;
+        len = RING_SIZE;
+    }
     
-    // Verify checksum
-    uint8_t calc_checksum = calculate_checksum(data, sizeof(TelemetryPacket) - 1);
-    if (calc_checksum != packet.checksum) {
-        // Checksum mismatch - log but still accept for debugging
-        // return false;
+    uint32_t space = RING_SIZE - available();
+    if (len > space) {
+        discard(len - space);
+        m_synced = false;
     }
     
+    uint32_t offset = m_write & (RING_SIZE - 1);
+    uint32_t first = RING_SIZE - offset;
+    if (first > len) first = len;
+    memcpy(m_ring + offset, data, first);
+    memcpy(m_ring, data + first, len - first);
+    m_write += len;
+}
+
+bool TelemetryFramer::next(TelemetryPacket& packet) {
+    while (available() > 0) {
+        // Skip to the next sync byte, scanning the contiguous part of the ring at once
+        if (!is_sync(peek(0))) {
+            uint32_t offset = m_read & (RING_SIZE - 1);
+            uint32_t span = RING_SIZE - offset;
+            if (span > available()) span = available();
+            
+            const uint8_t* start = m_ring + offset;
+            uint32_t skip = 1;
+            while (skip < span && !is_sync(start[skip])) skip++;
+            if (m_synced) {
+                m_synced = false;
+                m_stats.resyncs++;
+            }
+            discard(skip);
+            continue;
+        }
+        
+        if (peek(0) == PACKET_TYPE_TELEMETRY) {
+            if (available() < TELEMETRY_PACKET_SIZE) {
+                return false;
+            }
+            copy_out(m_frame, TELEMETRY_PACKET_SIZE);
+            if (!m_parser.parse_packet(m_frame, TELEMETRY_PACKET_SIZE, packet)) {
+                lose_sync();
+                continue;
+            }
+            m_read += TELEMETRY_PACKET_SIZE;
+            m_stats.keyframes++;
+        } else if (peek(0) == PACKET_TYPE_PARAM) {
+            if (available() < PARAM_PACKET_SIZE) {
+                return false;
+            }
+            copy_out(m_frame, PARAM_PACKET_SIZE);
+            ParamPacket param;
+            if (!decode_param_packet(m_frame, PARAM_PACKET_SIZE, param)) {
+                lose_sync();
+                continue;
+            }
+            m_read += PARAM_PACKET_SIZE;
+            m_synced = true;
+            m_stats.param_packets++;
+            if (m_param_write - m_param_read == PARAM_QUEUE_SIZE) {
+                m_param_read++;
+                m_stats.params_dropped++;
+            }
+            m_params[m_param_write++ & (PARAM_QUEUE_SIZE - 1)] = param;
+            continue;
+        } else {
+            if (available() < 2) {
+                return false;
+            }
+            uint8_t frame_len = peek(1);
+            if (frame_len < TELEMETRY_DELTA_MIN_SIZE || frame_len > TELEMETRY_DELTA_MAX_SIZE) {
+                lose_sync();
+                continue;
+            }
+            if (available() < frame_len) {
+                return false;
+            }
+            copy_out(m_frame, frame_len);
+            TelemetryDeltaHeader header;
+            if (!decode_telemetry_delta_header(m_frame, frame_len, header)) {
+                lose_sync();
+                continue;
+            }
+            m_read += frame_len;
+            m_synced = true;
+            if (!m_parser.apply_delta(header, m_frame + TELEMETRY_DELTA_HEADER_SIZE, packet)) {
+                m_stats.deltas_skipped++;
+                continue;
+            }
+            m_stats.delta_frames++;
+        }
+        
+        m_synced = true;
+        m_stats.packets++;
+        return true;
+    }
+    return false;
+}
+
+bool TelemetryFramer::next_param(ParamPacket& packet) {
+    if (m_param_read == m_param_write) {
+        return false;
+    }
+    packet = m_params[m_param_read++ & (PARAM_QUEUE_SIZE - 1)];
     return true;
 }
 
-uint8_t TelemetryParser::calculate_checksum(const uint8_t* data, uint16_t len) {
-    uint8_t checksum = 0;
-    for (uint16_t i = 0; i < len; i++) {
-        checksum ^= data[i];
+void TelemetryFramer::lose_sync() {
+    // False sync or corrupted frame - slide forward one byte and search again
+    m_stats.bad_checksums++;
+    if (m_synced) {
+        m_synced = false;
+        m_stats.resyncs++;
     }
-    return checksum;
+    discard(1);
+}
+
+void TelemetryFramer::copy_out(uint8_t* dst, uint32_t len) const {
+    uint32_t offset = m_read & (RING_SIZE - 1);
+    uint32_t first = RING_SIZE - offset;
+    if (first > len) first = len;
+    memcpy(dst, m_ring + offset, first);
+    memcpy(dst + first, m_ring, len - first);
+}
+
+void TelemetryFramer::discard(uint32_t len) {
+    m_read += len;
+    m_stats.bytes_discarded += len;
 }
@@ -1,66 +1,103 @@
 #pragma once
 
+#include "rov_protocol.h"
 #include <cstdint>
 #include <cstring>
 
-// Mirror firmware structures for PC side telemetry parsing
-struct TelemetrySensorData {
-    float gyro_x, gyro_y, gyro_z;
-    float accel_x, accel_y, accel_z;
-    float mag_x, mag_y, mag_z;
-    float depth;
-    float temperature;
-    float pressure;
-};
-
-struct TelemetryBatteryData {
-    float voltage;
-    float current;
-    float capacity_mah;
-    uint8_t percentage;
-};
-
-struct TelemetryCameraData {
-    uint8_t camera_type;
-    float servo_min_pwm;
-    float servo_max_pwm;
-    uint8_t gimbal_type;
-};
-
-struct TelemetryWaterSensorData {
-    int32_t pressure_offset;
-    float temp_offset;
-    uint8_t salinity_type;
-};
+// Telemetry structures are shared with the firmware through rov_protocol.h
+typedef SensorData TelemetrySensorData;
+typedef BatteryData TelemetryBatteryData;
+typedef CameraData TelemetryCameraData;
+typedef WaterSensorData TelemetryWaterSensorData;
+typedef PIDTuning TelemetryPIDTuning;
+typedef RobotState TelemetryRobotState;
 
-struct TelemetryPIDTuning {
-    float roll_p, roll_i, roll_d;
-    float pitch_p, pitch_i, pitch_d;
-    float yaw_p, yaw_i, yaw_d;
-    float depth_p, depth_i, depth_d;
-};
+static const uint8_t TELEMETRY_PACKET_TYPE = PACKET_TYPE_TELEMETRY;
 
-struct TelemetryRobotState {
-    uint8_t armed;
-    uint8_t flight_mode;
-    TelemetrySensorData sensors;
-    TelemetryBatteryData battery;
-    TelemetryCameraData camera;
-    TelemetryWaterSensorData water;
-    TelemetryPIDTuning pid_tuning;
-    float roll, pitch, yaw;
+// Decodes keyframes (full TelemetryPacket) and delta frames. Each keyframe
+// becomes the base state that later delta frames are applied to.
+class TelemetryParser {
+public:
+    TelemetryParser();
+    
+    // Keyframe. Returns false on short input, wrong packet type or CRC mismatch.
+    bool parse_packet(const uint8_t* data, uint16_t len, TelemetryPacket& packet);
+    
+    // Delta frame: validates it, then rebuilds the full state into packet.
+    // Returns false if the frame is invalid or no keyframe has been seen yet.
+    bool parse_delta_packet(const uint8_t* data, uint16_t len, TelemetryPacket& packet);
+    
+    // Apply an already validated delta frame (see decode_telemetry_delta_header).
+    // Returns false if no keyframe has been seen yet.
+    bool apply_delta(const TelemetryDeltaHeader& header, const uint8_t* payload, TelemetryPacket& packet);
+    
+    void reset() { m_have_keyframe = false; }
+    bool has_keyframe() const { return m_have_keyframe; }
+    
+private:
+    TelemetryRobotState m_state;
+    bool m_have_keyframe;
 };
 
-struct TelemetryPacket {
-    uint8_t packet_type;
-    TelemetryRobotState state;
-    uint8_t checksum;
+struct TelemetryFramerStats {
+    uint32_t packets;          // complete packets emitted
+    uint32_t keyframes;        // full packets among them
+    uint32_t delta_frames;     // delta frames among them
+    uint32_t deltas_skipped;   // valid delta frames received before any keyframe
+    uint32_t resyncs;          // times alignment was lost and had to be searched for
+    uint32_t bad_checksums;    // candidate frames rejected by CRC or length
+    uint32_t bytes_discarded;  // bytes skipped while searching for sync or on overflow
+    uint32_t param_packets;    // parameter replies decoded
+    uint32_t params_dropped;   // parameter replies overwritten before next_param() took them
 };
 
-class TelemetryParser {
+// Incremental framer for the telemetry byte stream.
+// TCP and serial split and coalesce packets arbitrarily, so received bytes are
+// appended with feed() and complete packets are popped with next() until it
+// returns false. Keyframes and delta frames may be interleaved; next() always
+// returns a full packet, with delta frames rebuilt on top of the last keyframe.
+// Parameter replies found in the stream are held aside for next_param().
+// All storage is preallocated; nothing is allocated per packet.
+class TelemetryFramer {
 public:
-    TelemetryParser();
+    TelemetryFramer();
     
-    bool parse_packet(const uint8_t* data, uint16_t len, TelemetryPacket& packet);
-    uint8_t calculate_checksum(const uint8_t* data, uint16_t len);
+    // Append received bytes. If the ring is full the oldest bytes are dropped.
+    void feed(const uint8_t* data, uint16_t len);
+    
+    // Extract the next valid packet. Returns false when more bytes are needed.
+    bool next(TelemetryPacket& packet);
+    
+    // Pop a parameter reply decoded by next(). Drain after each next() loop.
+    bool next_param(ParamPacket& packet);
+    
+    void reset();
+    const TelemetryFramerStats& get_stats() const { return m_stats; }
+    
+private:
+    static const uint32_t RING_SIZE = 4096;  // must be a power of two
+    static const uint32_t PARAM_QUEUE_SIZE = 32;  // must be a power of two
+    static const uint16_t MAX_FRAME_SIZE =
+        TELEMETRY_PACKET_SIZE > TELEMETRY_DELTA_MAX_SIZE ? TELEMETRY_PACKET_SIZE : TELEMETRY_DELTA_MAX_SIZE;
+    
+    static bool is_sync(uint8_t byte) {
+        return byte == PACKET_TYPE_TELEMETRY || byte == PACKET_TYPE_TELEMETRY_DELTA || byte == PACKET_TYPE_PARAM;
+    }
+    void lose_sync();
+    
+    uint32_t available() const { return m_write - m_read; }
+    uint8_t peek(uint32_t offset) const { return m_ring[(m_read + offset) & (RING_SIZE - 1)]; }
+    void copy_out(uint8_t* dst, uint32_t len) const;
+    void discard(uint32_t len);
+    
+    uint8_t m_ring[RING_SIZE];
+    uint32_t m_read;
+    uint32_t m_write;
+    uint8_t m_frame[MAX_FRAME_SIZE];
+    TelemetryParser m_parser;
+    ParamPacket m_params[PARAM_QUEUE_SIZE];
+    uint32_t m_param_read;
+    uint32_t m_param_write;
+    bool m_synced;
+    TelemetryFramerStats m_stats;
 };
@@ -8,7 +8,7 @@ TelemetryReceiver::TelemetryReceiver() {
 TelemetryReceiver::~TelemetryReceiver() {}
 
 void TelemetryReceiver::update_from_packet(const RemoteTelemetryPacket& pkt) {
-    if (pkt.packet_type == 2) {
+    if (pkt.packet_type == PACKET_TYPE_TELEMETRY) {
         latest_state = pkt.state;
     }
 }
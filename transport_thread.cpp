@@ -0,0 +1,219 @@
+#include "transport_thread.h"
+#include <chrono>
+#include <cstring>
+
+TransportThread::TransportThread()
+    : m_control_sequence(0), m_epoch(std::chrono::steady_clock::now()),
+      m_running(false), m_connected(false), m_connecting(false), m_config_requested(false),
+      m_dropped_telemetry(0), m_dropped_params(0) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+TransportThread::~TransportThread() {
+    close();
+}
+
+bool TransportThread::open_tcp(const std::string& host, uint16_t port) {
+    close();
+    m_connection.create_tcp_connection(host, port);
+    return start();
+}
+
+bool TransportThread::open_udp(const std::string& host, uint16_t port) {
+    close();
+    m_connection.create_udp_connection(host, port);
+    return start();
+}
+
+bool TransportThread::open_serial(const std::string& port, uint32_t baudrate) {
+    close();
+    m_connection.create_serial_connection(port, baudrate);
+    return start();
+}
+
+bool TransportThread::start() {
+    if (!m_connection.connect()) {
+        publish_error();
+        return false;
+    }
+
+    // Discard anything left over from a previous connection
+    m_framer.reset();
+    m_link.reset();
+    m_dropped_telemetry = 0;
+    m_dropped_params = 0;
+    ControlPacket stale_control;
+    while (m_control_queue.pop(stale_control)) {}
+    TelemetryPacket stale_telemetry;
+    while (m_telemetry_queue.pop(stale_telemetry)) {}
+    ParamPacket stale_param;
+    while (m_param_tx_queue.pop(stale_param)) {}
+    while (m_param_rx_queue.pop(stale_param)) {}
+
+    if (!m_connection.attach(m_loop, [this](const uint8_t* data, uint16_t len) { on_receive(data, len); })) {
+        publish_error();
+        m_connection.disconnect();
+        return false;
+    }
+
+    update_status();
+    publish_stats();
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&TransportThread::run, this);
+    return true;
+}
+
+void TransportThread::close() {
+    m_running.store(false, std::memory_order_release);
+    if (m_thread.joinable()) {
+        m_loop.wake();
+        m_thread.join();
+    }
+    m_connection.disconnect();
+    update_status();
+}
+
+void TransportThread::get_stats(TransportStats& stats) const {
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    stats = m_stats;
+}
+
+void TransportThread::publish_stats() {
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_stats.framer = m_framer.get_stats();
+    m_stats.dropped_telemetry = m_dropped_telemetry;
+    m_stats.dropped_params = m_dropped_params;
+    m_link.snapshot(m_stats.link);
+    const UDPBatchStats* udp = m_connection.get_udp_stats();
+    m_stats.has_udp = (udp != nullptr);
+    if (udp) {
+        m_stats.udp = *udp;
+    }
+}
+
+uint64_t TransportThread::now_us() const {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+std::string TransportThread::get_error() const {
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    return m_error;
+}
+
+void TransportThread::publish_error() {
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_error = m_connection.get_error();
+}
+
+void TransportThread::update_status() {
+    bool connected = m_connection.is_connected();
+    bool connecting = m_connection.is_connecting();
+    // Copy the error before the flags flip, so a UI that sees the link drop
+    // also sees why
+    if (connected != m_connected.load(std::memory_order_relaxed) ||
+        connecting != m_connecting.load(std::memory_order_relaxed)) {
+        publish_error();
+    }
+    m_connected.store(connected, std::memory_order_release);
+    m_connecting.store(connecting, std::memory_order_release);
+}
+
+bool TransportThread::push_control(const ControlPacket& packet) {
+    return m_control_queue.push(packet);
+}
+
+bool TransportThread::pop_telemetry(TelemetryPacket& packet) {
+    return m_telemetry_queue.pop(packet);
+}
+
+bool TransportThread::push_param(const ParamPacket& packet) {
+    return m_param_tx_queue.push(packet);
+}
+
+bool TransportThread::pop_param(ParamPacket& packet) {
+    return m_param_rx_queue.pop(packet);
+}
+
+void TransportThread::on_receive(const uint8_t* data, uint16_t len) {
+    m_framer.feed(data, len);
+    uint64_t arrival_us = now_us();
+    TelemetryPacket packet;
+    while (m_framer.next(packet)) {
+        m_link.on_telemetry(packet.sequence, packet.timestamp_ms, packet.control_echo, arrival_us);
+        if (!m_telemetry_queue.push(packet)) {
+            m_dropped_telemetry++;
+        }
+    }
+    ParamPacket param;
+    while (m_framer.next_param(param)) {
+        if (!m_param_rx_queue.push(param)) {
+            m_dropped_params++;
+        }
+    }
+}
+
+void TransportThread::run() {
+    typedef std::chrono::steady_clock Clock;
+    const std::chrono::milliseconds control_period(CONTROL_PERIOD_MS);
+
+    bool have_control = false;
+    Clock::time_point next_send = Clock::now();
+
+    while (m_running.load(std::memory_order_acquire)) {
+        // Block until the link has data or the next control send is due.
+        // Received bytes are drained into on_receive() from inside wait().
+        Clock::time_point now = Clock::now();
+        int timeout_ms = 0;
+        if (next_send > now) {
+            timeout_ms = (int)std::chrono::ceil<std::chrono::milliseconds>(next_send - now).count();
+        }
+        m_loop.wait(timeout_ms);
+
+        // Keep only the newest control state from the UI
+        ControlPacket control;
+        while (m_control_queue.pop(control)) {
+            m_sender.set_packet(control);
+            have_control = true;
+        }
+
+        now = Clock::now();
+        if (now >= next_send) {
+            if (have_control && m_connection.is_connected()) {
+                uint64_t sent_us = now_us();
+                m_sender.set_sequence(m_control_sequence, (uint32_t)(sent_us / 1000));
+                // Delta frames are useless until a keyframe arrives, so keep asking for one
+                uint8_t flags = 0;
+                if (m_framer.get_stats().keyframes == 0) {
+                    flags |= CONTROL_FLAG_REQUEST_KEYFRAME;
+                }
+                if (m_config_requested.exchange(false, std::memory_order_acq_rel)) {
+                    flags |= CONTROL_FLAG_REQUEST_CONFIG;
+                }
+                m_sender.set_flags(flags);
+                m_link.on_control_sent(m_control_sequence, sent_us);
+                m_control_sequence++;
+                uint8_t packet_data[CONTROL_PACKET_SIZE];
+                uint16_t len = m_sender.serialize_into(packet_data, sizeof(packet_data));
+                m_connection.queue_send(packet_data, len);
+            }
+            // Parameter requests wait in the queue while the link is still
+            // connecting, so the read-all queued right after open() is not lost
+            ParamPacket param;
+            while (m_connection.is_connected() && m_param_tx_queue.pop(param)) {
+                uint8_t param_data[PARAM_PACKET_SIZE];
+                m_connection.queue_send(param_data, encode_param_packet(param, param_data));
+            }
+            // Everything queued this tick goes out together (one sendmmsg on UDP)
+            m_connection.flush();
+            next_send += control_period;
+            // After a long stall, resume the schedule instead of sending a burst
+            if (next_send <= now) {
+                next_send = now + control_period;
+            }
+        }
+
+        update_status();
+        publish_stats();
+    }
+}
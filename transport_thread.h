@@ -0,0 +1,105 @@
+#pragma once
+
+#include "connection.h"
+#include "control_sender.h"
+#include "link_stats.h"
+#include "spsc_queue.h"
+#include "telemetry_parser.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Snapshot of transport counters, published by the I/O thread for the UI
+struct TransportStats {
+    TelemetryFramerStats framer;
+    uint32_t dropped_telemetry;  // decoded but the UI queue was full
+    uint32_t dropped_params;     // parameter replies lost to a full UI queue
+    bool has_udp;
+    UDPBatchStats udp;
+    LinkStatsSnapshot link;
+};
+
+// Background I/O thread that owns the active connection.
+// The UI loop only talks to it through SPSC queues: control packets in,
+// telemetry packets out, and parameter packets both ways. The thread blocks in
+// an epoll EventLoop until the link has data or the next 50Hz control send is
+// due, so a slow render frame or a blocking video read never delays either
+// direction.
+class TransportThread {
+public:
+    TransportThread();
+    ~TransportThread();
+
+    // Create and connect a connection, then start the I/O thread
+    bool open_tcp(const std::string& host, uint16_t port);
+    bool open_udp(const std::string& host, uint16_t port);
+    bool open_serial(const std::string& port, uint32_t baudrate);
+
+    // Stop the I/O thread and close the connection
+    void close();
+
+    bool is_connected() const { return m_connected.load(std::memory_order_acquire); }
+    bool is_connecting() const { return m_connecting.load(std::memory_order_acquire); }
+
+    // Last connection error, copied when open_* fails or the link state changes
+    // (e.g. a refused connect or a dropped link), so it is safe to call any time
+    std::string get_error() const;
+
+    // UI side: publish the latest control state. Only the newest queued packet is sent.
+    bool push_control(const ControlPacket& packet);
+
+    // UI side: pop the next received telemetry packet
+    bool pop_telemetry(TelemetryPacket& packet);
+
+    // UI side: queue a parameter READ or WRITE, sent with the first control tick
+    // once the link is connected
+    bool push_param(const ParamPacket& packet);
+
+    // UI side: pop the next parameter reply from the firmware
+    bool pop_param(ParamPacket& packet);
+
+    // Ask the firmware to resend its PID, camera and water config
+    void request_config() { m_config_requested.store(true, std::memory_order_release); }
+    
+    // Copy the most recently published counters
+    void get_stats(TransportStats& stats) const;
+
+    static const uint32_t CONTROL_PERIOD_MS = 20;  // 50Hz
+
+private:
+    bool start();
+    void run();
+    void on_receive(const uint8_t* data, uint16_t len);
+    void update_status();
+    void publish_error();
+    void publish_stats();
+    uint64_t now_us() const;
+
+    EventLoop m_loop;
+    ConnectionManager m_connection;
+    ControlSender m_sender;
+    TelemetryFramer m_framer;
+    LinkStats m_link;
+    uint16_t m_control_sequence;
+    std::chrono::steady_clock::time_point m_epoch;  // zero point for control timestamps
+
+    SPSCQueue<ControlPacket, 16> m_control_queue;
+    SPSCQueue<TelemetryPacket, 64> m_telemetry_queue;
+    SPSCQueue<ParamPacket, 64> m_param_tx_queue;
+    SPSCQueue<ParamPacket, 64> m_param_rx_queue;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_connected;
+    std::atomic<bool> m_connecting;
+    std::atomic<bool> m_config_requested;
+
+    uint32_t m_dropped_telemetry;
+    uint32_t m_dropped_params;
+    mutable std::mutex m_stats_mutex;
+    TransportStats m_stats;
+    std::string m_error;  // guarded by m_stats_mutex
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer: a single-slot "latest value" mailbox between one
+// writer thread and one reader thread.
+// The writer fills back() and publish()es it; the reader calls update() and, if
+// it returns true, reads front(). Neither side ever waits. A value published
+// before the reader picked up the previous one replaces it, so the reader always
+// sees the newest value and stale ones are dropped rather than queued.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : m_slots(), m_back(0), m_middle(1), m_front(2) {}
+
+    // Writer side: the slot being filled. Owned by the writer until publish().
+    T& back() { return m_slots[m_back]; }
+
+    // Writer side: hand back() to the reader and take a free slot as the new back().
+    // Returns true if the previously published value was never read (dropped).
+    bool publish() {
+        uint8_t previous = m_middle.exchange((uint8_t)(m_back | FRESH), std::memory_order_acq_rel);
+        m_back = previous & INDEX_MASK;
+        return (previous & FRESH) != 0;
+    }
+
+    // Reader side: swap in the newest published value. Returns false if nothing
+    // new has been published since the last call (front() is unchanged).
+    bool update() {
+        if (!(m_middle.load(std::memory_order_acquire) & FRESH)) {
+            return false;
+        }
+        uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & INDEX_MASK;
+        return true;
+    }
+
+    // Reader side: has a value been published that update() would take?
+    bool has_update() const {
+        return (m_middle.load(std::memory_order_acquire) & FRESH) != 0;
+    }
+
+    // Reader side: the most recently taken value. Owned by the reader until the next update().
+    T& front() { return m_slots[m_front]; }
+
+    // Direct slot access for setup and teardown, while no thread is using the buffer
+    T& slot(int index) { return m_slots[index]; }
+
+private:
+    static const uint8_t INDEX_MASK = 0x03;
+    static const uint8_t FRESH = 0x04;
+
+    T m_slots[3];
+    uint8_t m_back;                 // writer only
+    alignas(64) std::atomic<uint8_t> m_middle;  // index | FRESH
+    alignas(64) uint8_t m_front;    // reader only
+};
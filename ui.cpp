@@ -1,7 +1,8 @@
 #include "ui.h"
 #include "control_sender.h"
-#include "connection.h"
+#include "transport_thread.h"
 #include "telemetry_parser.h"
+#include "video.h"
 #include "imgui.h"
 #include "backends/imgui_impl_sdl2.h"
 #include "backends/imgui_impl_sdlrenderer2.h"
@@ -15,11 +16,22 @@ static SDL_Renderer *g_renderer = NULL;
 // Control sender for communicating with firmware
 static ControlSender g_control_sender;
 
-// Connection manager for all connection types
-static ConnectionManager g_connection;
+// Transport thread - owns the connection and runs the 50Hz control send
+static TransportThread g_transport;
+static bool g_link_open = false;    // opened from the UI and not yet closed or failed
+static bool g_link_was_up = false;  // reached CONNECTED since it was opened
 
-// Telemetry parser
-static TelemetryParser g_telemetry_parser;
+// Camera streams, owned by main(). The main camera fills the Flight tab's video
+// panel; the others are shown as thumbnails underneath.
+static const int MAX_VIDEO_STREAMS = 4;
+static VideoStream *g_video_streams[MAX_VIDEO_STREAMS] = {nullptr};
+static int g_video_stream_count = 0;
+static const VideoScheduler *g_video_scheduler = nullptr;
+
+// Main loop frame pacing, for the performance readout
+static const FrameScheduler *g_frames = nullptr;
+static int g_main_camera = 0;
+static int g_settings_camera = 0;  // Camera tab selection
 
 static bool g_armed = false;
 static int g_selected_tab = 0;
@@ -54,6 +66,82 @@ static struct {
     float pid_depth_p = 2.5f, pid_depth_i = 0.1f, pid_depth_d = 0.5f;
 } pid_params;
 
+// Vehicle-side motor settings, mirrored from parameter replies
+static struct {
+    int frame_type = 0;
+    bool reversed[8] = {false};
+    float thrust_factor[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+} motor_params;
+
+static const char* const FRAME_NAMES[] = {"Vectored (8x)", "Quadcopter (4x)", "Hexacopter (6x)", "Octocopter (8x)", "Custom"};
+
+// PID gains in ParamId order, PARAM_PID_ROLL_P onwards
+static float* const PID_PARAM_FIELDS[] = {
+    &pid_params.pid_roll_p, &pid_params.pid_roll_i, &pid_params.pid_roll_d,
+    &pid_params.pid_pitch_p, &pid_params.pid_pitch_i, &pid_params.pid_pitch_d,
+    &pid_params.pid_yaw_p, &pid_params.pid_yaw_i, &pid_params.pid_yaw_d,
+    &pid_params.pid_depth_p, &pid_params.pid_depth_i, &pid_params.pid_depth_d,
+};
+static_assert(sizeof(PID_PARAM_FIELDS) / sizeof(PID_PARAM_FIELDS[0]) == PARAM_PID_DEPTH_D - PARAM_PID_ROLL_P + 1,
+              "one PID field per parameter");
+
+static void send_param(uint8_t op, uint8_t id, float value)
+{
+    ParamPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.packet_type = PACKET_TYPE_PARAM;
+    packet.op = op;
+    packet.param_id = id;
+    packet.value = value;
+    if (!g_transport.push_param(packet)) {
+        ui_log("Parameter queue full, request dropped");
+    }
+}
+
+static void write_motor_params()
+{
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (motor_params.reversed[i]) mask |= (uint8_t)(1u << i);
+        send_param(PARAM_OP_WRITE, PARAM_THRUST_FACTOR_1 + i, motor_params.thrust_factor[i]);
+    }
+    send_param(PARAM_OP_WRITE, PARAM_MOTOR_REVERSED, (float)mask);
+}
+
+static void write_pid_params()
+{
+    for (uint8_t i = 0; i <= PARAM_PID_DEPTH_D - PARAM_PID_ROLL_P; i++) {
+        send_param(PARAM_OP_WRITE, PARAM_PID_ROLL_P + i, *PID_PARAM_FIELDS[i]);
+    }
+}
+
+static void apply_param(const ParamPacket& packet)
+{
+    if (packet.op != PARAM_OP_VALUE) return;
+    if (packet.status != PARAM_STATUS_OK) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "Vehicle rejected parameter %u (%s)", packet.param_id,
+            packet.status == PARAM_STATUS_UNKNOWN_ID ? "unknown" : "invalid value");
+        ui_log(msg);
+        if (packet.status == PARAM_STATUS_UNKNOWN_ID) return;
+        // INVALID replies still carry the current value, so fall through and show it
+    }
+    
+    uint8_t id = packet.param_id;
+    if (id == PARAM_FRAME_TYPE) {
+        motor_params.frame_type = (int)packet.value;
+    } else if (id == PARAM_MOTOR_REVERSED) {
+        uint8_t mask = (uint8_t)packet.value;
+        for (uint8_t i = 0; i < 8; i++) {
+            motor_params.reversed[i] = (mask >> i) & 1u;
+        }
+    } else if (id >= PARAM_THRUST_FACTOR_1 && id < PARAM_THRUST_FACTOR_1 + 8) {
+        motor_params.thrust_factor[id - PARAM_THRUST_FACTOR_1] = packet.value;
+    } else if (id >= PARAM_PID_ROLL_P && id <= PARAM_PID_DEPTH_D) {
+        *PID_PARAM_FIELDS[id - PARAM_PID_ROLL_P] = packet.value;
+    }
+}
+
 static struct {
     int camera_type = 0;
     float camera_servo_min = 1100.0f;
@@ -81,6 +169,12 @@ static struct {
     float roll = 0.0f, pitch = 0.0f, yaw = 0.0f;
     uint8_t armed = 0;
     uint8_t flight_mode = 0;
+    uint16_t link_tx_bytes_per_s = 0;
+    uint16_t link_capacity_bytes_per_s = 0;
+    uint16_t link_deferred_per_s = 0;
+    uint16_t link_control_rx_per_s = 0;
+    uint16_t link_control_errors = 0;
+    TaskTiming timing = {};
 } telemetry_data;
 
 // Connection settings
@@ -136,8 +230,72 @@ void ui_new_frame(void)
     ImGui::NewFrame();
 }
 
-void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
+void ui_set_frame_scheduler(const FrameScheduler *frames)
+{
+    g_frames = frames;
+}
+
+void ui_set_video_streams(VideoStream *const *streams, int count, const VideoScheduler *scheduler)
+{
+    g_video_scheduler = scheduler;
+    g_video_stream_count = (count < MAX_VIDEO_STREAMS) ? count : MAX_VIDEO_STREAMS;
+    for (int i = 0; i < g_video_stream_count; i++) {
+        g_video_streams[i] = streams[i];
+    }
+    g_main_camera = 0;
+    g_settings_camera = 0;
+}
+
+// Latency percentiles drawn over the top-left corner of the last item
+static void draw_latency_overlay(const VideoStream *stream)
+{
+    VideoLatencySnapshot latency;
+    stream->get_latency(latency);
+    char overlay[192];
+    int n = snprintf(overlay, sizeof(overlay),
+        "Demux->present p50 %.1f | p95 %.1f | p99 %.1f ms",
+        latency.total.p50_ms, latency.total.p95_ms, latency.total.p99_ms);
+    if (latency.glass_samples > 0 && n > 0 && n < (int)sizeof(overlay)) {
+        snprintf(overlay + n, sizeof(overlay) - n,
+            "\nGlass-to-glass p50 %.1f | p95 %.1f | p99 %.1f ms",
+            latency.glass.p50_ms, latency.glass.p95_ms, latency.glass.p99_ms);
+    }
+    ImVec2 origin = ImGui::GetItemRectMin();
+    ImVec2 text_size = ImGui::CalcTextSize(overlay);
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    draw_list->AddRectFilled(ImVec2(origin.x + 4, origin.y + 4),
+        ImVec2(origin.x + 12 + text_size.x, origin.y + 12 + text_size.y),
+        IM_COL32(0, 0, 0, 160), 4.0f);
+    draw_list->AddText(ImVec2(origin.x + 8, origin.y + 8), IM_COL32(255, 255, 0, 255), overlay);
+}
+
+// Firmware scheduler timing, one line per task; tasks that ever overran are highlighted
+static void draw_task_timing(const TaskTiming &timing)
 {
+    static const char *const TASK_NAMES[TASK_COUNT] = {"Sensors", "Control", "PWM", "Telemetry"};
+    bool any = false;
+    for (int i = 0; i < TASK_COUNT; i++) {
+        if (timing.tasks[i].rate_hz > 0) any = true;
+    }
+    if (!any) return;
+
+    ImGui::Text("FIRMWARE TASKS");
+    for (int i = 0; i < TASK_COUNT; i++) {
+        const TaskTimingEntry &task = timing.tasks[i];
+        ImVec4 color = task.overruns > 0 ? ImVec4(1.0f, 0.5f, 0.0f, 1.0f) : ImVec4(0.8f, 0.8f, 0.8f, 1.0f);
+        ImGui::TextColored(color, "%-10s %4u Hz | avg %5u us | max %5u us | overruns %u",
+            TASK_NAMES[i], task.rate_hz, task.avg_us, task.max_us, task.overruns);
+    }
+}
+
+void ui_draw(const ControllerState &ctrl)
+{
+    // Streams not drawn this frame drop to keyframe-only decoding
+    VideoVisibility visibility[MAX_VIDEO_STREAMS];
+    for (int i = 0; i < MAX_VIDEO_STREAMS; i++) {
+        visibility[i] = VIDEO_HIDDEN;
+    }
+
     const ImGuiViewport* viewport = ImGui::GetMainViewport();
     ImGui::SetNextWindowPos(viewport->WorkPos);
     ImGui::SetNextWindowSize(viewport->WorkSize);
@@ -188,30 +346,94 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
             
             ImGui::Separator();
             
-            if (g_connection.is_connected()) {
+            if (g_transport.is_connected()) {
                 ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Status: CONNECTED");
                 if (ImGui::Button("Disconnect", ImVec2(120, 30))) {
-                    g_connection.disconnect();
+                    g_transport.close();
+                    g_link_open = false;
                     ui_log("Disconnected");
                 }
+                
+                TransportStats stats;
+                g_transport.get_stats(stats);
+                ImGui::Separator();
+                ImGui::Text("LINK STATISTICS");
+                ImGui::Text("Telemetry packets: %u | Resyncs: %u | Bad checksums: %u | Discarded: %u bytes",
+                    stats.framer.packets, stats.framer.resyncs, stats.framer.bad_checksums,
+                    stats.framer.bytes_discarded);
+                ImGui::Text("Keyframes: %u | Delta frames: %u | Deltas before first keyframe: %u",
+                    stats.framer.keyframes, stats.framer.delta_frames, stats.framer.deltas_skipped);
+                if (telemetry_data.link_capacity_bytes_per_s > 0) {
+                    float utilization = 100.0f * telemetry_data.link_tx_bytes_per_s /
+                                        telemetry_data.link_capacity_bytes_per_s;
+                    ImGui::Text("Firmware TX: %u of %u B/s (%.0f%%) | Deferred groups: %u/s",
+                        telemetry_data.link_tx_bytes_per_s, telemetry_data.link_capacity_bytes_per_s,
+                        utilization, telemetry_data.link_deferred_per_s);
+                    ImGui::Text("Firmware RX: %u control packets/s | Framing errors: %u",
+                        telemetry_data.link_control_rx_per_s, telemetry_data.link_control_errors);
+                }
+                draw_task_timing(telemetry_data.timing);
+                if (ImGui::Button("Request Config")) {
+                    g_transport.request_config();
+                }
+                if (stats.dropped_telemetry > 0) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), "Dropped by UI queue: %u", stats.dropped_telemetry);
+                }
+                if (stats.link.received > 0) {
+                    ImVec4 loss_color = (stats.link.loss_rate > 0.05f) ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) :
+                                        (stats.link.loss_rate > 0.01f) ? ImVec4(1.0f, 1.0f, 0.0f, 1.0f) :
+                                                                         ImVec4(0.0f, 1.0f, 0.0f, 1.0f);
+                    ImGui::TextColored(loss_color, "Loss: %.1f%% (%u of %u) | Rate: %.1f Hz",
+                        stats.link.loss_rate * 100.0f, stats.link.expected - stats.link.received,
+                        stats.link.expected, stats.link.rate_hz);
+                    ImGui::Text("Reordered: %u | Duplicates: %u | Jitter: %.2f ms",
+                        stats.link.reordered, stats.link.duplicates, stats.link.jitter_ms);
+                    if (stats.link.rtt_samples > 0) {
+                        ImGui::Text("RTT p50 %.1f ms | p95 %.1f ms | p99 %.1f ms | max %.1f ms (%u samples)",
+                            stats.link.rtt_p50_ms, stats.link.rtt_p95_ms, stats.link.rtt_p99_ms,
+                            stats.link.rtt_max_ms, stats.link.rtt_samples);
+                    } else {
+                        ImGui::Text("RTT: waiting for control echo");
+                    }
+                }
+                if (stats.has_udp) {
+                    float avg_batch = stats.udp.recv_calls ?
+                        (float)stats.udp.recv_datagrams / (float)stats.udp.recv_calls : 0.0f;
+                    ImGui::Text("recvmmsg: %llu calls, %llu datagrams, avg batch %.2f, max %u",
+                        (unsigned long long)stats.udp.recv_calls, (unsigned long long)stats.udp.recv_datagrams,
+                        avg_batch, stats.udp.max_recv_batch);
+                    ImGui::Text("sendmmsg: %llu calls, %llu datagrams",
+                        (unsigned long long)stats.udp.send_calls, (unsigned long long)stats.udp.send_datagrams);
+                }
+            } else if (g_transport.is_connecting()) {
+                ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Status: CONNECTING...");
+                if (ImGui::Button("Cancel", ImVec2(120, 30))) {
+                    g_transport.close();
+                    g_link_open = false;
+                    ui_log("Connection cancelled");
+                }
             } else {
                 ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), "Status: DISCONNECTED");
                 if (ImGui::Button("Connect", ImVec2(120, 30))) {
                     uint32_t baudrates[] = {9600, 19200, 57600, 115200};
                     
+                    bool opened;
                     if (connection_settings.connection_type == 0) {
-                        g_connection.create_tcp_connection(connection_settings.tcp_host, connection_settings.tcp_port);
+                        opened = g_transport.open_tcp(connection_settings.tcp_host, connection_settings.tcp_port);
                     } else if (connection_settings.connection_type == 1) {
-                        g_connection.create_udp_connection(connection_settings.udp_host, connection_settings.udp_port);
+                        opened = g_transport.open_udp(connection_settings.udp_host, connection_settings.udp_port);
                     } else {
-                        g_connection.create_serial_connection(connection_settings.serial_port, 
+                        opened = g_transport.open_serial(connection_settings.serial_port, 
                             baudrates[connection_settings.serial_baudrate]);
                     }
                     
-                    if (g_connection.connect()) {
-                        ui_log("Connected successfully");
+                    if (opened) {
+                        g_link_open = true;
+                        g_link_was_up = g_transport.is_connected();
+                        ui_log(g_link_was_up ? "Connected successfully" : "Connecting...");
+                        send_param(PARAM_OP_READ, PARAM_ID_ALL, 0.0f);
                     } else {
-                        std::string msg = "Connection failed: " + g_connection.get_error();
+                        std::string msg = "Connection failed: " + g_transport.get_error();
                         ui_log(msg.c_str());
                     }
                 }
@@ -226,17 +448,55 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
             
             ImGui::BeginChild("VideoPanel", ImVec2(available_width * 0.72f, available_height * 0.6f), false);
             ImGui::Text("CAMERA FEED");
+            for (int i = 0; i < g_video_stream_count; i++) {
+                ImGui::SameLine();
+                if (ImGui::RadioButton(g_video_streams[i]->name().c_str(), g_main_camera == i)) {
+                    g_main_camera = i;
+                }
+            }
             ImGui::Separator();
+            VideoStream *main_stream = (g_video_stream_count > 0) ? g_video_streams[g_main_camera] : nullptr;
+            SDL_Texture *video_tex = main_stream ? main_stream->texture() : nullptr;
+            float thumbnail_height = (g_video_stream_count > 1) ? 90.0f : 0.0f;
+            if (main_stream) {
+                visibility[g_main_camera] = VIDEO_VISIBLE;
+            }
             if (video_tex) {
-                int w, h;
-                SDL_QueryTexture(video_tex, NULL, NULL, &w, &h);
                 float panel_width = ImGui::GetContentRegionAvail().x - 10;
-                float panel_height = ImGui::GetContentRegionAvail().y - 10;
+                float panel_height = ImGui::GetContentRegionAvail().y - 10 - thumbnail_height;
                 ImVec2 display_size = ImVec2(panel_width, panel_height);
                 ImGui::Image((ImTextureID)video_tex, display_size, ImVec2(0,0), ImVec2(1,1));
+                if (main_stream->is_instrumented()) {
+                    draw_latency_overlay(main_stream);
+                }
+                if (main_stream->state() != VIDEO_STREAMING) {
+                    // Last frame stays up, marked stale, while the worker reconnects
+                    ImVec2 origin = ImGui::GetItemRectMin();
+                    ImGui::GetWindowDrawList()->AddText(ImVec2(origin.x + 8, origin.y + display_size.y - 24),
+                        IM_COL32(255, 80, 80, 255), video_state_name(main_stream->state()));
+                }
+            } else if (main_stream) {
+                ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "No video feed (%s)",
+                    video_state_name(main_stream->state()));
             } else {
                 ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "No video feed");
             }
+            if (g_video_stream_count > 1) {
+                // Other cameras as thumbnails; click one to make it the main view
+                for (int i = 0; i < g_video_stream_count; i++) {
+                    if (i == g_main_camera) continue;
+                    visibility[i] = VIDEO_THUMBNAIL;
+                    SDL_Texture *thumb = g_video_streams[i]->texture();
+                    ImGui::PushID(i);
+                    bool clicked = thumb
+                        ? ImGui::ImageButton("##thumb", (ImTextureID)thumb, ImVec2(thumbnail_height * 16.0f / 9.0f, thumbnail_height - 10))
+                        : ImGui::Button(g_video_streams[i]->name().c_str(), ImVec2(thumbnail_height * 16.0f / 9.0f, thumbnail_height - 10));
+                    if (clicked) g_main_camera = i;
+                    ImGui::PopID();
+                    ImGui::SameLine();
+                }
+                ImGui::NewLine();
+            }
             ImGui::EndChild();
             
             ImGui::SameLine();
@@ -244,7 +504,7 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
             ImGui::BeginChild("ControlPanel", ImVec2(available_width * 0.27f, available_height * 0.6f), false);
             
             // Connection status
-            if (g_connection.is_connected()) {
+            if (g_transport.is_connected()) {
                 ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "CONNECTED TO PIXHAWK");
             } else {
                 ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "DISCONNECTED - Go to Connection tab");
@@ -253,7 +513,7 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
             
             // ARM button - disabled if not connected
             ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(12, 10));
-            bool can_arm = g_connection.is_connected();
+            bool can_arm = g_transport.is_connected();
             
             if (!can_arm) {
                 ImGui::BeginDisabled();
@@ -351,7 +611,21 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
             
             ImGui::Text("Vehicle Type: Submarine (ROV)");
             ImGui::Text("Flight Controller: Pixhawk 2.4.8");
-            ImGui::Text("Frame Type: Vectored");
+            ImGui::Text("Frame Type: %s", FRAME_NAMES[motor_params.frame_type >= 0 && motor_params.frame_type < 5 ? motor_params.frame_type : 4]);
+            
+            if (g_frames) {
+                FrameStatsSnapshot perf;
+                g_frames->snapshot(perf);
+                ImGui::Separator();
+                ImGui::Text("GUI PERFORMANCE");
+                ImGui::Text("Achieved: %.1f FPS | Frames drawn: %u of %u wakeups",
+                    perf.fps, perf.frames, perf.wakeups);
+                ImGui::Text("Frame time p50 %.2f ms | p95 %.2f ms | p99 %.2f ms | max %.2f ms",
+                    perf.frame_p50_ms, perf.frame_p95_ms, perf.frame_p99_ms, perf.frame_max_ms);
+                ImGui::Text("CPU per frame: avg %.2f ms | p95 %.2f ms", perf.cpu_avg_ms, perf.cpu_p95_ms);
+                ImGui::Text("Redraws - input: %u | video: %u | telemetry: %u | animation: %u | idle: %u",
+                    perf.reasons[0], perf.reasons[1], perf.reasons[2], perf.reasons[3], perf.reasons[4]);
+            }
             
             ImGui::EndTabItem();
         }
@@ -380,6 +654,22 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
             ImGui::SliderFloat("##depth_i", &pid_params.pid_depth_i, 0.0f, 1.0f);
             ImGui::SliderFloat("##depth_d", &pid_params.pid_depth_d, 0.0f, 2.0f);
             
+            ImGui::Separator();
+            if (!g_transport.is_connected()) {
+                ImGui::BeginDisabled();
+            }
+            if (ImGui::Button("Write to Vehicle", ImVec2(150, 25))) {
+                write_pid_params();
+                ui_log("PID gains sent");
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Read from Vehicle", ImVec2(150, 25))) {
+                send_param(PARAM_OP_READ, PARAM_ID_ALL, 0.0f);
+            }
+            if (!g_transport.is_connected()) {
+                ImGui::EndDisabled();
+            }
+            
             ImGui::EndTabItem();
         }
         
@@ -461,6 +751,111 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
             ImGui::Combo("##gimbal_type", &camera_params.camera_gimbal_type,
                 "NONE\0TWO_AXIS\0THREE_AXIS\0");
             
+            ImGui::Separator();
+            ImGui::Text("VIDEO PIPELINE");
+            if (g_video_stream_count > 0 && ImGui::BeginCombo("Camera##pipeline", g_video_streams[g_settings_camera]->name().c_str())) {
+                for (int i = 0; i < g_video_stream_count; i++) {
+                    if (ImGui::Selectable(g_video_streams[i]->name().c_str(), g_settings_camera == i)) {
+                        g_settings_camera = i;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            VideoStream *stream = (g_video_stream_count > 0) ? g_video_streams[g_settings_camera] : nullptr;
+            VideoStats video_stats = VideoStats();
+            if (stream) {
+                stream->get_stats(video_stats);
+            }
+            if (stream) {
+                ImVec4 state_color = (video_stats.state == VIDEO_STREAMING) ? ImVec4(0.0f, 1.0f, 0.0f, 1.0f) :
+                                     (video_stats.state == VIDEO_STALLED) ? ImVec4(1.0f, 1.0f, 0.0f, 1.0f) :
+                                                                            ImVec4(1.0f, 0.5f, 0.0f, 1.0f);
+                ImGui::TextColored(state_color, "State: %s", video_state_name(video_stats.state));
+                if (video_stats.state == VIDEO_RECONNECTING && video_stats.backoff_ms > 0) {
+                    ImGui::SameLine();
+                    ImGui::Text("(retry in up to %u ms)", video_stats.backoff_ms);
+                }
+                ImGui::Text("Connect attempts: %u | Reconnects: %u", video_stats.connect_attempts, video_stats.reconnects);
+                if (video_stats.reconnects > 0) {
+                    ImGui::Text("Last reconnect: %.0f ms (outage %.0f ms)",
+                        video_stats.last_reconnect_ms, video_stats.last_outage_ms);
+                }
+            }
+            if (!stream) {
+                ImGui::Text("No cameras configured");
+            } else if (video_stats.frames_decoded > 0) {
+                ImGui::Text("Frames decoded: %u | Displayed: %u | Dropped: %u",
+                    video_stats.frames_decoded, video_stats.frames_displayed, video_stats.frames_dropped);
+                ImGui::Text("Decode: avg %.1f ms | max %.1f ms",
+                    video_stats.decode_ms_avg, video_stats.decode_ms_max);
+                ImGui::Text("Demux to display: avg %.1f ms | max %.1f ms",
+                    video_stats.latency_ms_avg, video_stats.latency_ms_max);
+                ImGui::Text("Decoder threads: %d (%d of %d in use across cameras)",
+                    video_stats.decode_threads, g_video_scheduler->threads_in_use(), g_video_scheduler->max_decode_threads());
+            } else {
+                ImGui::Text("No frames decoded yet");
+            }
+            if (stream) {
+                ImGui::Separator();
+                ImGui::Text("RECORDING");
+                static char record_dir[256] = ".";
+                static int record_container = 0;
+                static int record_rotate_minutes = 10;
+                static int record_rotate_mb = 2048;
+                RecordingStats recording;
+                stream->get_recording_stats(recording);
+                if (!recording.recording) {
+                    ImGui::InputText("Directory##record", record_dir, sizeof(record_dir));
+                    ImGui::Combo("Container##record", &record_container, "MP4 (fragmented)\0MKV\0");
+                    ImGui::InputInt("Rotate after minutes (0 = off)", &record_rotate_minutes);
+                    ImGui::InputInt("Rotate after MB (0 = off)", &record_rotate_mb);
+                    if (ImGui::Button("Start Recording", ImVec2(160, 30))) {
+                        RecordingOptions options;
+                        options.directory = record_dir;
+                        options.prefix = "rov_" + stream->name();
+                        for (char &c : options.prefix) {
+                            if (c == ' ') c = '_';
+                        }
+                        options.matroska = (record_container == 1);
+                        options.rotate_seconds = record_rotate_minutes > 0 ? (uint32_t)record_rotate_minutes * 60 : 0;
+                        options.rotate_bytes = record_rotate_mb > 0 ? (uint64_t)record_rotate_mb * 1024 * 1024 : 0;
+                        stream->start_recording(options);
+                        ui_log("Recording requested - starts at the next keyframe");
+                    }
+                } else {
+                    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "REC %s",
+                        recording.current_file.empty() ? "(waiting for keyframe)" : recording.current_file.c_str());
+                    if (ImGui::Button("Stop Recording", ImVec2(160, 30))) {
+                        stream->stop_recording();
+                        ui_log("Recording stopped");
+                    }
+                }
+                if (recording.files > 0 || recording.recording) {
+                    ImGui::Text("Files: %u | Packets: %llu | %.1f MB | Dropped: %u | Queue peak: %u | Write errors: %u",
+                        recording.files, (unsigned long long)recording.packets_written,
+                        recording.bytes_written / (1024.0 * 1024.0), recording.packets_dropped,
+                        recording.queue_peak, recording.write_errors);
+                }
+
+                if (stream->is_instrumented()) {
+                    VideoLatencySnapshot latency;
+                    stream->get_latency(latency);
+                    ImGui::Text("Latency over %u frames (p50 / p95 / p99 ms):", latency.samples);
+                    ImGui::Text("  Decode %.1f / %.1f / %.1f | Handoff %.1f / %.1f / %.1f | Present %.1f / %.1f / %.1f",
+                        latency.decode.p50_ms, latency.decode.p95_ms, latency.decode.p99_ms,
+                        latency.handoff.p50_ms, latency.handoff.p95_ms, latency.handoff.p99_ms,
+                        latency.present.p50_ms, latency.present.p95_ms, latency.present.p99_ms);
+                    if (ImGui::Button("Dump latency CSV")) {
+                        time_t now = time(nullptr);
+                        char path[64];
+                        strftime(path, sizeof(path), "video_latency_%Y%m%d_%H%M%S.csv", localtime(&now));
+                        std::string msg = stream->dump_latency_csv(path) ? std::string("Wrote ") + path
+                                                                       : std::string("Failed to write ") + path;
+                        ui_log(msg.c_str());
+                    }
+                }
+            }
+            
             ImGui::EndTabItem();
         }
         
@@ -485,33 +880,43 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
             ImGui::Text("FRAME AND MOTOR CONFIGURATION");
             ImGui::Separator();
             
-            static int selected_frame = 0;
+            if (!g_transport.is_connected()) {
+                ImGui::BeginDisabled();
+            }
+            
             ImGui::Text("Select Frame Type:");
-            ImGui::Combo("##frame_type", &selected_frame,
-                "Vectored (8x)\0Quadcopter (4x)\0Hexacopter (6x)\0Octocopter (8x)\0Custom\0");
+            ImGui::Combo("##frame_type", &motor_params.frame_type, FRAME_NAMES, 5);
             
             if (ImGui::Button("Apply Frame", ImVec2(150, 30))) {
-                ui_log("Frame type changed");
+                // The firmware refuses while armed, and for frames it has no tables for
+                send_param(PARAM_OP_WRITE, PARAM_FRAME_TYPE, (float)motor_params.frame_type);
+                ui_log("Frame type sent");
             }
             
             ImGui::Separator();
-            ImGui::Text("MOTOR REVERSAL AND CONFIGURATION");
-            
-            static bool motor_reversed[8] = {false};
-            static float motor_angle[8] = {0, 45, 90, 135, 180, 225, 270, 315};
+            ImGui::Text("MOTOR REVERSAL AND THRUST");
             
             ImGui::Columns(2, "motor_config", true);
             for (uint8_t i = 0; i < 8; i++) {
                 char label[32];
                 snprintf(label, sizeof(label), "M%d Reversed##rev%d", i+1, i);
-                ImGui::Checkbox(label, &motor_reversed[i]);
-                snprintf(label, sizeof(label), "M%d Angle##ang%d", i+1, i);
-                ImGui::SliderFloat(label, &motor_angle[i], 0.0f, 360.0f, "%.1f°");
+                ImGui::Checkbox(label, &motor_params.reversed[i]);
+                snprintf(label, sizeof(label), "M%d Thrust##thr%d", i+1, i);
+                ImGui::SliderFloat(label, &motor_params.thrust_factor[i], 0.5f, 2.0f, "%.2fx");
             }
             ImGui::Columns(1);
             
             if (ImGui::Button("Save Motor Config", ImVec2(200, 25))) {
-                ui_log("Motor configuration saved");
+                write_motor_params();
+                ui_log("Motor configuration sent; the vehicle saves it to flash");
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Read from Vehicle##motors", ImVec2(200, 25))) {
+                send_param(PARAM_OP_READ, PARAM_ID_ALL, 0.0f);
+            }
+            
+            if (!g_transport.is_connected()) {
+                ImGui::EndDisabled();
             }
             
             ImGui::Separator();
@@ -524,7 +929,7 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
             static float test_throttle = 0.0f;
             ImGui::SliderFloat("##test_throttle", &test_throttle, 0.0f, 1.0f, "%.2f");
             
-            if (!g_connection.is_connected()) {
+            if (!g_transport.is_connected()) {
                 ImGui::BeginDisabled();
             }
             
@@ -546,7 +951,7 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
                 ui_log("Motor stop");
             }
             
-            if (!g_connection.is_connected()) {
+            if (!g_transport.is_connected()) {
                 ImGui::EndDisabled();
                 ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Connect to Pixhawk first!");
             }
@@ -605,6 +1010,10 @@ void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex)
     }
     
     ImGui::End();
+
+    for (int i = 0; i < g_video_stream_count; i++) {
+        g_video_streams[i]->set_visibility(visibility[i]);
+    }
 }
 
 void ui_render()
@@ -639,57 +1048,89 @@ void ui_shutdown(void)
 
 void ui_send_control_packet(const ControllerState &ctrl)
 {
-    if (!g_connection.is_connected()) return;
+    if (!g_transport.is_connected()) return;
     
     // Update control sender with current controller state
     g_control_sender.set_control_mode(ctrl);
     g_control_sender.set_armed(g_armed);
     
-    // Serialize and send the packet
-    auto packet_data = g_control_sender.serialize();
-    if (!packet_data.empty()) {
-        g_connection.send(packet_data.data(), packet_data.size());
-    }
+    // Hand the snapshot to the transport thread, which sends it on its own 50Hz timer
+    g_transport.push_control(g_control_sender.get_packet());
 }
 
-void ui_receive_telemetry()
+static void apply_telemetry(const TelemetryPacket& packet)
 {
-    uint8_t buffer[2048];
-    uint16_t received_len = 0;
+    telemetry_data.battery_voltage = packet.state.battery.voltage;
+    telemetry_data.battery_current = packet.state.battery.current;
+    telemetry_data.battery_percentage = packet.state.battery.percentage;
     
-    if (!g_connection.is_connected()) return;
+    telemetry_data.gyro_x = packet.state.sensors.gyro_x;
+    telemetry_data.gyro_y = packet.state.sensors.gyro_y;
+    telemetry_data.gyro_z = packet.state.sensors.gyro_z;
     
-    // Try to receive data
-    if (g_connection.receive(buffer, sizeof(buffer), received_len) && received_len > 0) {
-        TelemetryPacket packet;
-        if (g_telemetry_parser.parse_packet(buffer, received_len, packet)) {
-            // Update telemetry data from packet
-            telemetry_data.battery_voltage = packet.state.battery.voltage;
-            telemetry_data.battery_current = packet.state.battery.current;
-            telemetry_data.battery_percentage = packet.state.battery.percentage;
-            
-            telemetry_data.gyro_x = packet.state.sensors.gyro_x;
-            telemetry_data.gyro_y = packet.state.sensors.gyro_y;
-            telemetry_data.gyro_z = packet.state.sensors.gyro_z;
-            
-            telemetry_data.accel_x = packet.state.sensors.accel_x;
-            telemetry_data.accel_y = packet.state.sensors.accel_y;
-            telemetry_data.accel_z = packet.state.sensors.accel_z;
-            
-            telemetry_data.mag_x = packet.state.sensors.mag_x;
-            telemetry_data.mag_y = packet.state.sensors.mag_y;
-            telemetry_data.mag_z = packet.state.sensors.mag_z;
-            
-            telemetry_data.depth = packet.state.sensors.depth;
-            telemetry_data.temperature = packet.state.sensors.temperature;
-            telemetry_data.pressure = packet.state.sensors.pressure;
-            
-            telemetry_data.roll = packet.state.roll;
-            telemetry_data.pitch = packet.state.pitch;
-            telemetry_data.yaw = packet.state.yaw;
-            
-            telemetry_data.armed = packet.state.armed;
-            telemetry_data.flight_mode = packet.state.flight_mode;
-        }
+    telemetry_data.accel_x = packet.state.sensors.accel_x;
+    telemetry_data.accel_y = packet.state.sensors.accel_y;
+    telemetry_data.accel_z = packet.state.sensors.accel_z;
+    
+    telemetry_data.mag_x = packet.state.sensors.mag_x;
+    telemetry_data.mag_y = packet.state.sensors.mag_y;
+    telemetry_data.mag_z = packet.state.sensors.mag_z;
+    
+    telemetry_data.depth = packet.state.sensors.depth;
+    telemetry_data.temperature = packet.state.sensors.temperature;
+    telemetry_data.pressure = packet.state.sensors.pressure;
+    
+    telemetry_data.roll = packet.state.roll;
+    telemetry_data.pitch = packet.state.pitch;
+    telemetry_data.yaw = packet.state.yaw;
+    
+    telemetry_data.armed = packet.state.armed;
+    telemetry_data.flight_mode = packet.state.flight_mode;
+    
+    telemetry_data.link_tx_bytes_per_s = packet.state.link.tx_bytes_per_s;
+    telemetry_data.link_capacity_bytes_per_s = packet.state.link.capacity_bytes_per_s;
+    telemetry_data.link_deferred_per_s = packet.state.link.deferred_per_s;
+    telemetry_data.link_control_rx_per_s = packet.state.link.control_rx_per_s;
+    telemetry_data.link_control_errors = packet.state.link.control_errors;
+    telemetry_data.timing = packet.state.timing;
+}
+
+bool ui_receive_telemetry()
+{
+    // Drain everything the transport thread decoded since the last poll
+    bool received = false;
+    TelemetryPacket packet;
+    while (g_transport.pop_telemetry(packet)) {
+        apply_telemetry(packet);
+        received = true;
+    }
+    ParamPacket param;
+    while (g_transport.pop_param(param)) {
+        apply_param(param);
+        received = true;
     }
+    return received;
+}
+
+bool ui_poll_link_status()
+{
+    // A non-blocking connect completes, fails, or the link drops on the
+    // transport thread; report the outcome here since no button press did
+    if (!g_link_open) return false;
+    if (g_transport.is_connected()) {
+        if (g_link_was_up) return false;
+        g_link_was_up = true;
+        ui_log("Connected successfully");
+        return true;
+    }
+    if (g_transport.is_connecting()) return false;
+    std::string msg = (g_link_was_up ? "Connection lost: " : "Connection failed: ") + g_transport.get_error();
+    ui_log(msg.c_str());
+    g_link_open = false;
+    return true;
+}
+
+bool ui_is_connected_to_pixhawk()
+{
+    return g_transport.is_connected();
 }
@@ -1,15 +1,20 @@
 #pragma once
 #include <SDL2/SDL.h>
+#include "frame_scheduler.h"
 #include "input.h"
+#include "video.h"
 
 void ui_init(SDL_Window *window, SDL_Renderer *renderer);
 void ui_process_event(const SDL_Event &e);
 void ui_new_frame();
-void ui_draw(const ControllerState &ctrl, SDL_Texture *video_tex);
+void ui_set_video_streams(VideoStream *const *streams, int count, const VideoScheduler *scheduler);
+void ui_set_frame_scheduler(const FrameScheduler *frames);
+void ui_draw(const ControllerState &ctrl);
 void ui_render();
 void ui_shutdown();
 void ui_log(const char *message);
 void ui_send_control_packet(const ControllerState &ctrl);
-void ui_receive_telemetry();  // Send control data to firmware
+bool ui_receive_telemetry();  // Drain received telemetry; true if any arrived
+bool ui_poll_link_status();   // Log connect results and dropped links; true on a change
 bool ui_connect_to_pixhawk(const char* host, uint16_t port);
 bool ui_is_connected_to_pixhawk();
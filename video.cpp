@@ -1,162 +1,708 @@
 #include "video.h"
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
+#include <string>
+#include <chrono>
 #include <thread>
 #include <atomic>
+#include <mutex>
 
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
 }
 
-static AVFormatContext *fmt_ctx   = nullptr;
-static AVCodecContext  *codec_ctx = nullptr;
-static int              video_stream_index = -1;
-static AVFrame         *frame     = nullptr;
-static AVPacket        *pkt       = nullptr;
+static const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
 
-static SDL_Renderer *g_renderer = nullptr;
-static SDL_Texture  *g_texture  = nullptr;
-static int g_tex_w = 0, g_tex_h = 0;
-static std::atomic<bool> g_initialized{false};
+static uint64_t now_us()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - g_epoch).count();
+}
 
-bool video_init(const char *rtsp_url, SDL_Renderer *renderer)
+static int64_t wall_clock_us()
 {
-    g_renderer = renderer;
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Exponentially weighted average over roughly the last 16 samples
+static void ewma(float &avg, float sample)
+{
+    avg = (avg == 0.0f) ? sample : avg + (sample - avg) / 16.0f;
+}
+
+const char *video_state_name(int state)
+{
+    switch (state) {
+    case VIDEO_CONNECTING:   return "CONNECTING";
+    case VIDEO_STREAMING:    return "STREAMING";
+    case VIDEO_STALLED:      return "STALLED";
+    case VIDEO_RECONNECTING: return "RECONNECTING";
+    default:                 return "IDLE";
+    }
+}
+
+// ============== VideoScheduler ==============
+
+VideoScheduler::VideoScheduler(int max_decode_threads)
+    : m_max(max_decode_threads), m_in_use(0), m_streams(0)
+{
+    if (m_max <= 0) {
+        int hw = (int)std::thread::hardware_concurrency();
+        m_max = std::max(1, hw - 1);
+    }
+}
+
+int VideoScheduler::acquire(int requested)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int want = (requested > 0) ? requested : std::max(1, m_max / (m_streams + 1));
+    // Every stream gets at least its own decode thread, even past the budget
+    int granted = std::max(1, std::min(want, m_max - m_in_use));
+    m_in_use += granted;
+    m_streams++;
+    return granted;
+}
+
+void VideoScheduler::release(int granted)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_in_use -= granted;
+    m_streams--;
+}
+
+int VideoScheduler::threads_in_use() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_in_use;
+}
+
+// ============== VideoStream ==============
+
+VideoStream::VideoStream(const char *name, VideoScheduler &scheduler)
+    : m_name(name), m_scheduler(scheduler),
+      m_fmt_ctx(nullptr), m_codec_ctx(nullptr), m_stream_index(-1), m_pkt(nullptr),
+      m_granted_threads(0), m_applied_visibility(VIDEO_VISIBLE), m_packet_time_next(0),
+      m_source_wrap_us(0), m_running(false), m_initialized(false), m_visibility(VIDEO_VISIBLE),
+      m_state(VIDEO_IDLE), m_io_deadline_us(0), m_last_packet_us(0), m_lost_us(0),
+      m_lost_last_packet_us(0), m_first_attempt_done(false),
+      m_record_request(RECORD_NONE),
+      m_renderer(nullptr), m_texture(nullptr), m_tex_w(0), m_tex_h(0),
+      m_tex_format(SDL_PIXELFORMAT_UNKNOWN), m_sws(nullptr), m_conv(nullptr),
+      m_sws_src_fmt(AV_PIX_FMT_NONE), m_sws_src_full_range(false), m_have_pending(false), m_pending_source_us(-1)
+{
+    memset(&m_pending, 0, sizeof(m_pending));
+    m_stats = VideoStats();
+}
+
+VideoStream::~VideoStream()
+{
+    close();
+}
+
+// FFmpeg polls this while blocked in I/O. Aborts the call when close() is
+// waiting or the current deadline has passed, so a dead socket is noticed in
+// read_timeout_ms rather than whenever TCP gives up.
+int VideoStream::interrupt_callback(void *opaque)
+{
+    VideoStream *self = static_cast<VideoStream*>(opaque);
+    if (!self->m_running.load()) return 1;
+    uint64_t now = now_us();
+    if (now > self->m_io_deadline_us.load()) return 1;
+    if (self->m_state.load() == VIDEO_STREAMING &&
+        now - self->m_last_packet_us.load() > (uint64_t)self->m_options.stall_ms * 1000) {
+        self->m_state = VIDEO_STALLED;
+    }
+    return 0;
+}
+
+void VideoStream::close_stream()
+{
+    if (m_pkt)       { av_packet_free(&m_pkt); }
+    if (m_codec_ctx) { avcodec_free_context(&m_codec_ctx); }
+    if (m_fmt_ctx)   { avformat_close_input(&m_fmt_ctx); }
+    if (m_granted_threads > 0) {
+        m_scheduler.release(m_granted_threads);
+        m_granted_threads = 0;
+    }
+    m_stream_index = -1;
+    m_initialized = false;
+}
+
+bool VideoStream::open_stream(const char *url)
+{
+    m_fmt_ctx = avformat_alloc_context();
+    if (!m_fmt_ctx) {
+        std::fprintf(stderr, "[%s] Failed to alloc format context\n", m_name.c_str());
+        return false;
+    }
+    m_fmt_ctx->interrupt_callback.callback = interrupt_callback;
+    m_fmt_ctx->interrupt_callback.opaque = this;
+    set_io_deadline(now_us() + (uint64_t)m_options.open_timeout_ms * 1000);
 
-    avformat_network_init();
-    
     AVDictionary *options = nullptr;
-    av_dict_set(&options, "rtsp_transport", "tcp", 0);
+    av_dict_set(&options, "rtsp_transport", m_options.udp_transport ? "udp" : "tcp", 0);
     av_dict_set(&options, "stimeout", "5000000", 0);
-    
-    if (avformat_open_input(&fmt_ctx, rtsp_url, nullptr, &options) < 0) {
-        std::fprintf(stderr, "Failed to open RTSP: %s\n", rtsp_url);
+    if (m_options.low_latency) {
+        // Hand packets over as soon as they arrive and keep probing short
+        av_dict_set(&options, "fflags", "nobuffer", 0);
+        av_dict_set(&options, "flags", "low_delay", 0);
+        av_dict_set_int(&options, "probesize", m_options.probesize, 0);
+        av_dict_set_int(&options, "analyzeduration", m_options.analyzeduration_us, 0);
+        if (m_options.udp_transport) {
+            av_dict_set(&options, "reorder_queue_size", "0", 0);
+        }
+    }
+
+    // On failure avformat_open_input frees fmt_ctx and sets it to NULL
+    if (avformat_open_input(&m_fmt_ctx, url, nullptr, &options) < 0) {
+        std::fprintf(stderr, "[%s] Failed to open RTSP: %s\n", m_name.c_str(), url);
         av_dict_free(&options);
         return false;
     }
     av_dict_free(&options);
-    if (avformat_find_stream_info(fmt_ctx, nullptr) < 0) {
-        std::fprintf(stderr, "Failed to get stream info\n");
+    if (avformat_find_stream_info(m_fmt_ctx, nullptr) < 0) {
+        std::fprintf(stderr, "[%s] Failed to get stream info\n", m_name.c_str());
         return false;
     }
 
     // Find video stream
-    for (unsigned i = 0; i < fmt_ctx->nb_streams; i++) {
-        if (fmt_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            video_stream_index = static_cast<int>(i);
+    for (unsigned i = 0; i < m_fmt_ctx->nb_streams; i++) {
+        if (m_fmt_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            m_stream_index = static_cast<int>(i);
             break;
         }
     }
-    if (video_stream_index < 0) {
-        std::fprintf(stderr, "No video stream found\n");
+    if (m_stream_index < 0) {
+        std::fprintf(stderr, "[%s] No video stream found\n", m_name.c_str());
         return false;
     }
 
-    AVCodecParameters *codecpar = fmt_ctx->streams[video_stream_index]->codecpar;
+    AVStream *stream = m_fmt_ctx->streams[m_stream_index];
+    m_source_wrap_us = (stream->pts_wrap_bits < 63)
+        ? av_rescale_q(1LL << stream->pts_wrap_bits, stream->time_base, AVRational{1, 1000000})
+        : INT64_MAX;
+
+    AVCodecParameters *codecpar = stream->codecpar;
     const AVCodec *codec = avcodec_find_decoder(codecpar->codec_id);
     if (!codec) {
-        std::fprintf(stderr, "No suitable decoder\n");
+        std::fprintf(stderr, "[%s] No suitable decoder\n", m_name.c_str());
         return false;
     }
 
-    codec_ctx = avcodec_alloc_context3(codec);
-    if (!codec_ctx) {
-        std::fprintf(stderr, "Failed to alloc codec context\n");
+    m_codec_ctx = avcodec_alloc_context3(codec);
+    if (!m_codec_ctx) {
+        std::fprintf(stderr, "[%s] Failed to alloc codec context\n", m_name.c_str());
         return false;
     }
 
-    if (avcodec_parameters_to_context(codec_ctx, codecpar) < 0) {
-        std::fprintf(stderr, "Failed to copy codec params\n");
+    if (avcodec_parameters_to_context(m_codec_ctx, codecpar) < 0) {
+        std::fprintf(stderr, "[%s] Failed to copy codec params\n", m_name.c_str());
         return false;
     }
 
-    if (avcodec_open2(codec_ctx, codec, nullptr) < 0) {
-        std::fprintf(stderr, "Failed to open codec\n");
-        return false;
+    if (m_options.low_latency) {
+        m_codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        m_codec_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
     }
+    m_granted_threads = m_scheduler.acquire(m_options.decode_threads);
+    m_codec_ctx->thread_count = m_granted_threads;
+    m_codec_ctx->thread_type = m_options.frame_threads ? FF_THREAD_FRAME : FF_THREAD_SLICE;
 
-    frame = av_frame_alloc();
-    pkt   = av_packet_alloc();
-    if (!frame || !pkt) {
-        std::fprintf(stderr, "Failed to alloc frame/packet\n");
+    if (avcodec_open2(m_codec_ctx, codec, nullptr) < 0) {
+        std::fprintf(stderr, "[%s] Failed to open codec\n", m_name.c_str());
         return false;
     }
+    m_applied_visibility = VIDEO_VISIBLE;
+    apply_visibility();
 
-    g_tex_w = codec_ctx->width;
-    g_tex_h = codec_ctx->height;
-    if (g_tex_w <= 0 || g_tex_h <= 0) {
-        std::fprintf(stderr, "Invalid video size\n");
+    m_pkt = av_packet_alloc();
+    if (!m_pkt) {
+        std::fprintf(stderr, "[%s] Failed to alloc packet\n", m_name.c_str());
         return false;
     }
 
-    // RGB24 texture. If source isn’t RGB24, we’ll need sws_scale later.
-    g_texture = SDL_CreateTexture(
-        g_renderer, SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STREAMING,
-        g_tex_w, g_tex_h
-    );
-    if (!g_texture) {
-        std::fprintf(stderr, "Failed to create SDL texture\n");
-        return false;
+    {
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        m_stats.decode_threads = m_granted_threads;
     }
-
-    g_initialized = true;
+    m_initialized = true;
     return true;
 }
 
-void video_init_async(const char *rtsp_url, SDL_Renderer *renderer)
+// Decode less for streams the UI isn't fully showing. skip_frame is read by
+// the decoder on every packet, so it can change mid-stream.
+void VideoStream::apply_visibility()
 {
-    std::thread t([rtsp_url, renderer]() {
-        video_init(rtsp_url, renderer);
-    });
-    t.detach();
+    int visibility = m_visibility.load();
+    if (visibility == m_applied_visibility) return;
+    m_applied_visibility = visibility;
+    switch (visibility) {
+    case VIDEO_THUMBNAIL: m_codec_ctx->skip_frame = AVDISCARD_NONREF; break;
+    case VIDEO_HIDDEN:    m_codec_ctx->skip_frame = AVDISCARD_NONKEY; break;
+    default:              m_codec_ctx->skip_frame = AVDISCARD_DEFAULT; break;
+    }
 }
 
-bool video_is_initialized()
+void VideoStream::handle_record_request()
 {
-    return g_initialized.load();
+    int request = m_record_request.exchange(RECORD_NONE);
+    if (request == RECORD_START && !m_recorder.is_recording()) {
+        RecordingOptions options;
+        {
+            std::lock_guard<std::mutex> lock(m_record_mutex);
+            options = m_record_options;
+        }
+        if (!m_recorder.start(m_fmt_ctx->streams[m_stream_index], options)) {
+            std::fprintf(stderr, "[%s] Failed to start recording\n", m_name.c_str());
+        }
+    } else if (request == RECORD_STOP) {
+        m_recorder.request_stop();
+    }
 }
 
-void video_update()
+uint64_t VideoStream::demux_time_for(int64_t pts, uint64_t fallback_us) const
 {
-    if (!fmt_ctx || !codec_ctx) return;
+    if (pts == AV_NOPTS_VALUE) return fallback_us;
+    for (int i = 0; i < PACKET_TIMES; i++) {
+        if (m_packet_times[i].pts == pts) return m_packet_times[i].demux_us;
+    }
+    return fallback_us;
+}
 
-    if (av_read_frame(fmt_ctx, pkt) >= 0) {
-        if (pkt->stream_index == video_stream_index) {
-            if (avcodec_send_packet(codec_ctx, pkt) == 0) {
-                while (avcodec_receive_frame(codec_ctx, frame) == 0) {
-                    if (frame->format == AV_PIX_FMT_RGB24) {
-                        void *pixels = nullptr;
-                        int pitch = 0;
-                        if (SDL_LockTexture(g_texture, nullptr, &pixels, &pitch) == 0) {
-                            uint8_t *dst = static_cast<uint8_t*>(pixels);
-                            for (int y = 0; y < g_tex_h; ++y) {
-                                memcpy(dst + y * pitch,
-                                       frame->data[0] + y * frame->linesize[0],
-                                       g_tex_w * 3);
-                            }
-                            SDL_UnlockTexture(g_texture);
-                        }
-                    } else {
+// Demux and decode until close() or until the stream is lost. Each decoded
+// frame is published to the mailbox; the decoder then writes the next one
+// into a different slot. Returns the number of frames decoded.
+uint32_t VideoStream::decode_loop()
+{
+    uint32_t decoded = 0;
+    m_last_packet_us = now_us();
+    while (m_running.load()) {
+        set_io_deadline(m_last_packet_us.load() + (uint64_t)m_options.read_timeout_ms * 1000);
+        int ret = av_read_frame(m_fmt_ctx, m_pkt);
+        if (ret == AVERROR(EAGAIN)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        if (ret < 0) {
+            // EOF, socket error, or read_timeout_ms without a packet
+            return decoded;
+        }
+        uint64_t demux_us = now_us();
+        m_last_packet_us = demux_us;
+        if (m_state.load() == VIDEO_STALLED) {
+            m_state = VIDEO_STREAMING;
+        }
+        if (m_pkt->stream_index == m_stream_index) {
+            handle_record_request();
+            m_recorder.push(m_pkt);
+            apply_visibility();
+
+            m_packet_times[m_packet_time_next].pts = m_pkt->pts;
+            m_packet_times[m_packet_time_next].demux_us = demux_us;
+            m_packet_time_next = (m_packet_time_next + 1) % PACKET_TIMES;
+
+            if (avcodec_send_packet(m_codec_ctx, m_pkt) == 0) {
+                // avcodec_receive_frame unrefs whatever the slot held before
+                while (avcodec_receive_frame(m_codec_ctx, m_mailbox.back().frame) == 0) {
+                    DecodedFrame &out = m_mailbox.back();
+                    out.demux_us = demux_time_for(out.frame->pts, demux_us);
+                    out.decoded_us = now_us();
+                    out.source_us = -1;
+                    if (m_options.source_clock && out.frame->pts != AV_NOPTS_VALUE) {
+                        AVRational tb = m_fmt_ctx->streams[m_stream_index]->time_base;
+                        int64_t pts_us = av_rescale_q(out.frame->pts, tb, AVRational{1, 1000000});
+                        int64_t wrap_us = m_source_wrap_us.load();
+                        out.source_us = pts_us % wrap_us;
+                        if (out.source_us < 0) out.source_us += wrap_us;
+                    }
+                    uint64_t decoded_us = out.decoded_us;
+                    float decode_ms = (float)(decoded_us - demux_us) / 1000.0f;
+                    bool dropped = m_mailbox.publish();
+                    if (m_frame_callback) m_frame_callback();
+                    decoded++;
 
+                    std::lock_guard<std::mutex> lock(m_stats_mutex);
+                    if (m_lost_us != 0) {
+                        m_stats.reconnects++;
+                        m_stats.last_reconnect_ms = (float)(decoded_us - m_lost_us) / 1000.0f;
+                        m_stats.last_outage_ms = (float)(decoded_us - m_lost_last_packet_us) / 1000.0f;
+                        m_lost_us = 0;
                     }
+                    m_stats.frames_decoded++;
+                    if (dropped) m_stats.frames_dropped++;
+                    ewma(m_stats.decode_ms_avg, decode_ms);
+                    if (decode_ms > m_stats.decode_ms_max) m_stats.decode_ms_max = decode_ms;
                 }
             }
         }
-        av_packet_unref(pkt);
+        av_packet_unref(m_pkt);
+    }
+    return decoded;
+}
+
+// Worker thread: connect, stream until the connection is lost, then retry.
+// Failed attempts back off exponentially; a stream that delivered frames and
+// then dropped is retried at once. A server that accepts the session but
+// closes it before any frame counts as a failed attempt, so it can't pull
+// the loop into back-to-back reconnects. Only this thread ever touches the
+// FFmpeg contexts.
+void VideoStream::supervise(std::string url)
+{
+    uint32_t backoff_ms = (uint32_t)m_options.reconnect_min_ms;
+    m_lost_us = 0;
+    while (m_running.load()) {
+        {
+            std::lock_guard<std::mutex> lock(m_stats_mutex);
+            m_stats.connect_attempts++;
+        }
+        bool connected = open_stream(url.c_str());
+        if (connected) {
+            m_state = VIDEO_STREAMING;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_state_mutex);
+            m_first_attempt_done = true;
+        }
+        m_state_cv.notify_all();
+
+        bool delivered = false;
+        if (connected) {
+            delivered = decode_loop() > 0;
+            if (!m_running.load()) break;
+
+            m_lost_us = now_us();
+            m_lost_last_packet_us = m_last_packet_us.load();
+            std::fprintf(stderr, "[%s] Stream lost, reconnecting\n", m_name.c_str());
+            // Finish the current recording file; carry on in a new one once reconnected
+            if (m_recorder.is_recording()) {
+                m_recorder.request_stop();
+                m_recorder.join();
+                int expected = RECORD_NONE;
+                m_record_request.compare_exchange_strong(expected, RECORD_START);
+            }
+        }
+        close_stream();
+        if (!m_running.load()) break;
+
+        m_state = VIDEO_RECONNECTING;
+        {
+            std::lock_guard<std::mutex> lock(m_stats_mutex);
+            m_stats.backoff_ms = delivered ? 0 : backoff_ms;
+        }
+        if (delivered) {
+            backoff_ms = (uint32_t)m_options.reconnect_min_ms;
+        } else {
+            std::unique_lock<std::mutex> lock(m_state_mutex);
+            m_state_cv.wait_for(lock, std::chrono::milliseconds(backoff_ms),
+                                [this]() { return !m_running.load(); });
+            backoff_ms = std::min(backoff_ms * 2, (uint32_t)m_options.reconnect_max_ms);
+        }
+    }
+    close_stream();
+    m_state = VIDEO_IDLE;
+}
+
+bool VideoStream::start(SDL_Renderer *renderer, const VideoOptions &options)
+{
+    close();
+    m_renderer = renderer;
+    m_options = options;
+    avformat_network_init();
+
+    for (int i = 0; i < PACKET_TIMES; i++) {
+        m_packet_times[i].pts = AV_NOPTS_VALUE;
+        m_packet_times[i].demux_us = 0;
+    }
+    m_packet_time_next = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        m_stats = VideoStats();
+    }
+    m_latency.reset();
+    m_have_pending = false;
+
+    for (int i = 0; i < 3; i++) {
+        m_mailbox.slot(i).frame = av_frame_alloc();
+        m_mailbox.slot(i).demux_us = 0;
+        m_mailbox.slot(i).decoded_us = 0;
+        m_mailbox.slot(i).source_us = -1;
+        if (!m_mailbox.slot(i).frame) {
+            std::fprintf(stderr, "[%s] Failed to alloc frame\n", m_name.c_str());
+            return false;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+        m_first_attempt_done = false;
+    }
+    m_state = VIDEO_CONNECTING;
+    m_running = true;
+    return true;
+}
+
+bool VideoStream::open(const char *url, SDL_Renderer *renderer, const VideoOptions &options)
+{
+    open_async(url, renderer, options);
+    std::unique_lock<std::mutex> lock(m_state_mutex);
+    m_state_cv.wait(lock, [this]() { return m_first_attempt_done || !m_running.load(); });
+    return m_state.load() == VIDEO_STREAMING;
+}
+
+void VideoStream::open_async(const char *url, SDL_Renderer *renderer, const VideoOptions &options)
+{
+    if (!start(renderer, options)) return;
+    m_decode_thread = std::thread(&VideoStream::supervise, this, std::string(url));
+}
+
+// Full-range (JPEG) YUV, as MJPEG cameras produce: either a YUVJ format or a
+// plain YUV format tagged with the JPEG range
+static bool is_full_range(const AVFrame *frame)
+{
+    switch (frame->format) {
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUVJ444P: return true;
+    default:                  return frame->color_range == AVCOL_RANGE_JPEG;
+    }
+}
+
+// SDL texture format that can take this decoder output as-is, so the renderer
+// does the colour conversion. SDL_PIXELFORMAT_UNKNOWN means it needs converting.
+// SDL2 YUV textures are always limited range, so full-range YUV goes through sws.
+static Uint32 sdl_format_for(const AVFrame *frame)
+{
+    switch (frame->format) {
+    case AV_PIX_FMT_RGB24:    return SDL_PIXELFORMAT_RGB24;
+    case AV_PIX_FMT_BGR24:    return SDL_PIXELFORMAT_BGR24;
+    default:                  break;
+    }
+    if (is_full_range(frame)) return SDL_PIXELFORMAT_UNKNOWN;
+    switch (frame->format) {
+    case AV_PIX_FMT_YUV420P:  return SDL_PIXELFORMAT_IYUV;
+    case AV_PIX_FMT_NV12:     return SDL_PIXELFORMAT_NV12;
+    case AV_PIX_FMT_NV21:     return SDL_PIXELFORMAT_NV21;
+    case AV_PIX_FMT_YUYV422:  return SDL_PIXELFORMAT_YUY2;
+    case AV_PIX_FMT_UYVY422:  return SDL_PIXELFORMAT_UYVY;
+    default:                  return SDL_PIXELFORMAT_UNKNOWN;
+    }
+}
+
+void VideoStream::free_converter()
+{
+    if (m_sws)  { sws_freeContext(m_sws); m_sws = nullptr; }
+    if (m_conv) { av_frame_free(&m_conv); }
+    m_sws_src_fmt = AV_PIX_FMT_NONE;
+    m_sws_src_full_range = false;
+}
+
+// Convert an unsupported frame to limited-range YUV420P. The context and
+// destination buffer are only rebuilt when the source format, range or size changes.
+AVFrame *VideoStream::convert_frame(const AVFrame *frame)
+{
+    bool full_range = is_full_range(frame);
+    if (!m_sws || frame->format != m_sws_src_fmt || full_range != m_sws_src_full_range ||
+        frame->width != m_conv->width || frame->height != m_conv->height) {
+        free_converter();
+        m_sws = sws_getContext(frame->width, frame->height, (AVPixelFormat)frame->format,
+                               frame->width, frame->height, AV_PIX_FMT_YUV420P,
+                               SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+        m_conv = av_frame_alloc();
+        if (!m_sws || !m_conv) {
+            std::fprintf(stderr, "[%s] Failed to create pixel format converter\n", m_name.c_str());
+            free_converter();
+            return nullptr;
+        }
+        // Expand the source range explicitly: a plain YUV format tagged as
+        // JPEG range would otherwise be scaled as limited range
+        const int *coeffs = sws_getCoefficients(SWS_CS_DEFAULT);
+        sws_setColorspaceDetails(m_sws, coeffs, full_range ? 1 : 0, coeffs, 0,
+                                 0, 1 << 16, 1 << 16);
+        m_conv->format = AV_PIX_FMT_YUV420P;
+        m_conv->width  = frame->width;
+        m_conv->height = frame->height;
+        if (av_frame_get_buffer(m_conv, 0) < 0) {
+            std::fprintf(stderr, "[%s] Failed to alloc conversion frame\n", m_name.c_str());
+            free_converter();
+            return nullptr;
+        }
+        m_sws_src_fmt = frame->format;
+        m_sws_src_full_range = full_range;
+    }
+    sws_scale(m_sws, frame->data, frame->linesize, 0, frame->height,
+              m_conv->data, m_conv->linesize);
+    return m_conv;
+}
+
+// Copy a packed single-plane frame into a locked streaming texture
+void VideoStream::upload_packed(const AVFrame *frame, int bytes_per_row)
+{
+    void *pixels = nullptr;
+    int pitch = 0;
+    if (SDL_LockTexture(m_texture, nullptr, &pixels, &pitch) != 0) return;
+    uint8_t *dst = static_cast<uint8_t*>(pixels);
+    for (int y = 0; y < m_tex_h; ++y) {
+        memcpy(dst + y * pitch,
+               frame->data[0] + y * frame->linesize[0],
+               bytes_per_row);
+    }
+    SDL_UnlockTexture(m_texture);
+}
+
+// Render thread: upload the newest decoded frame, if there is one.
+// The texture is created here because SDL renderers are not thread-safe.
+// YUV planes are uploaded as-is and converted to RGB by the renderer.
+bool VideoStream::update()
+{
+    if (!m_mailbox.update()) return false;
+    const DecodedFrame &decoded = m_mailbox.front();
+    AVFrame *frame = decoded.frame;
+    uint64_t demux_us = decoded.demux_us;
+    if (frame->width <= 0 || frame->height <= 0) return false;
+
+    Uint32 format = sdl_format_for(frame);
+    if (format == SDL_PIXELFORMAT_UNKNOWN) {
+        frame = convert_frame(frame);
+        if (!frame) return false;
+        format = SDL_PIXELFORMAT_IYUV;
+    }
+
+    if (!m_texture || frame->width != m_tex_w || frame->height != m_tex_h ||
+        format != m_tex_format) {
+        if (m_texture) SDL_DestroyTexture(m_texture);
+        m_tex_w = frame->width;
+        m_tex_h = frame->height;
+        m_tex_format = format;
+        m_texture = SDL_CreateTexture(
+            m_renderer, format, SDL_TEXTUREACCESS_STREAMING,
+            m_tex_w, m_tex_h
+        );
+        if (!m_texture) {
+            std::fprintf(stderr, "[%s] Failed to create SDL texture: %s\n", m_name.c_str(), SDL_GetError());
+            return false;
+        }
+    }
+
+    switch (format) {
+    case SDL_PIXELFORMAT_IYUV:
+        SDL_UpdateYUVTexture(m_texture, nullptr,
+                             frame->data[0], frame->linesize[0],
+                             frame->data[1], frame->linesize[1],
+                             frame->data[2], frame->linesize[2]);
+        break;
+    case SDL_PIXELFORMAT_NV12:
+    case SDL_PIXELFORMAT_NV21:
+        SDL_UpdateNVTexture(m_texture, nullptr,
+                            frame->data[0], frame->linesize[0],
+                            frame->data[1], frame->linesize[1]);
+        break;
+    case SDL_PIXELFORMAT_YUY2:
+    case SDL_PIXELFORMAT_UYVY:
+        // Packed 4:2:2: 2 bytes per pixel, width rounded up to a macropixel
+        upload_packed(frame, ((m_tex_w + 1) & ~1) * 2);
+        break;
+    default:
+        upload_packed(frame, m_tex_w * 3);
+        break;
+    }
+
+    uint64_t upload_us = now_us();
+    if (m_options.instrument) {
+        // A frame replaced before present was never shown; only the newest one counts
+        m_pending.demux_us = demux_us;
+        m_pending.decoded_us = decoded.decoded_us;
+        m_pending.upload_us = upload_us;
+        m_pending_source_us = decoded.source_us;
+        m_have_pending = true;
+    }
+
+    float latency_ms = (float)(upload_us - demux_us) / 1000.0f;
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_stats.frames_displayed++;
+    ewma(m_stats.latency_ms_avg, latency_ms);
+    if (latency_ms > m_stats.latency_ms_max) m_stats.latency_ms_max = latency_ms;
+    return true;
+}
+
+void VideoStream::close()
+{
+    bool was_started = m_running.exchange(false) || m_decode_thread.joinable();
+    {
+        // Wake a backoff wait; the interrupt callback aborts blocking I/O
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+    }
+    m_state_cv.notify_all();
+    if (m_decode_thread.joinable()) m_decode_thread.join();
+    m_state = VIDEO_IDLE;
+    m_initialized = false;
+    m_recorder.request_stop();
+    m_recorder.join();
+
+    if (m_texture) { SDL_DestroyTexture(m_texture); m_texture = nullptr; }
+    m_tex_format = SDL_PIXELFORMAT_UNKNOWN;
+    free_converter();
+    for (int i = 0; i < 3; i++) {
+        if (m_mailbox.slot(i).frame) av_frame_free(&m_mailbox.slot(i).frame);
+    }
+    close_stream();
+    if (was_started) avformat_network_deinit();
+}
+
+void VideoStream::get_stats(VideoStats &stats) const
+{
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    stats = m_stats;
+    stats.state = m_state.load();
+}
+
+void VideoStream::on_present()
+{
+    if (!m_have_pending) return;
+    m_pending.present_us = now_us();
+    m_pending.glass_us = -1;
+    int64_t wrap_us = m_source_wrap_us.load();
+    if (m_pending_source_us >= 0 && wrap_us > 0) {
+        // Both clocks are taken modulo the pts wrap: fold the difference into
+        // (-wrap/2, wrap/2] so a wrap between capture and present stays small
+        int64_t glass_us = wall_clock_us() % wrap_us - m_pending_source_us;
+        if (glass_us > wrap_us / 2) glass_us -= wrap_us;
+        else if (glass_us <= -wrap_us / 2) glass_us += wrap_us;
+        // A source clock running ahead of ours gives no usable sample
+        if (glass_us >= 0) m_pending.glass_us = glass_us;
+    }
+    m_latency.on_presented(m_pending);
+    m_have_pending = false;
+}
+
+void VideoStream::get_latency(VideoLatencySnapshot &snapshot) const
+{
+    m_latency.snapshot(snapshot);
+}
+
+bool VideoStream::dump_latency_csv(const char *path) const
+{
+    return m_latency.dump_csv(path);
+}
+
+void VideoStream::start_recording(const RecordingOptions &options)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_record_mutex);
+        m_record_options = options;
     }
+    m_record_request = RECORD_START;
 }
 
-SDL_Texture *video_get_texture()
+void VideoStream::stop_recording()
 {
-    return g_texture;
+    m_record_request = RECORD_STOP;
 }
 
-void video_shutdown()
+void VideoStream::get_recording_stats(RecordingStats &stats) const
 {
-    if (g_texture) { SDL_DestroyTexture(g_texture); g_texture = nullptr; }
-    if (frame)     { av_frame_free(&frame); frame = nullptr; }
-    if (pkt)       { av_packet_free(&pkt);  pkt = nullptr; }
-    if (codec_ctx) { avcodec_free_context(&codec_ctx); codec_ctx = nullptr; }
-    if (fmt_ctx)   { avformat_close_input(&fmt_ctx); fmt_ctx = nullptr; }
-    avformat_network_deinit();
+    m_recorder.get_stats(stats);
 }
@@ -1,11 +1,252 @@
 #pragma once
 #include <SDL2/SDL.h>
+#include "triple_buffer.h"
+#include "video_latency.h"
+#include "video_recorder.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <atomic>
+#include <condition_variable>
+#include <functional>
 
-bool video_init(const char *rtsp_url, SDL_Renderer *renderer);
-void video_init_async(const char *rtsp_url, SDL_Renderer *renderer);
-void video_update();
-SDL_Texture *video_get_texture();
-void video_shutdown();
-bool video_is_initialized();
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+// Demuxer and decoder settings for the camera stream
+struct VideoOptions {
+    bool low_latency = true;        // fflags=nobuffer, flags=low_delay, minimal probing
+    bool udp_transport = false;     // RTSP over UDP instead of interleaved TCP
+    int probesize = 32768;          // bytes probed by avformat_find_stream_info (low-latency only)
+    int analyzeduration_us = 100000; // stream-info analysis cap (low-latency only); FFmpeg reads
+                                     // 0 as its 5 s default, so keep this non-zero
+    int decode_threads = 2;         // requested from the VideoScheduler; 0 = as many as it allows
+    bool frame_threads = false;     // frame threading (adds threads-1 frames of delay,
+                                    // FFmpeg disables it under low_delay) instead of slice threading
+    bool instrument = false;        // record per-frame pipeline timestamps (see on_present)
+    bool source_clock = false;      // stream pts carry the sender's wall clock (test source below)
+    int open_timeout_ms = 5000;     // abort a connect attempt (open + stream info) after this
+    int stall_ms = 1000;            // no packets for this long: STALLED
+    int read_timeout_ms = 3000;     // no packets for this long: drop the connection and reconnect
+    int reconnect_min_ms = 250;     // first retry delay, doubled after each failed attempt
+    int reconnect_max_ms = 8000;
+};
+
+// Connection state of a VideoStream's worker
+enum VideoState {
+    VIDEO_IDLE,             // not opened, or closed
+    VIDEO_CONNECTING,       // first connection attempt
+    VIDEO_STREAMING,
+    VIDEO_STALLED,          // connected but no packets for stall_ms
+    VIDEO_RECONNECTING      // lost or failed; retrying with exponential backoff
+};
+
+const char *video_state_name(int state);
+
+// Glass-to-glass test source for instrument + source_clock. Run on the same machine
+// (or one sharing an NTP clock) and open "udp://127.0.0.1:5600":
+//   ffmpeg -re -f lavfi -i testsrc2=size=1280x720:rate=30
+//     -vf "settb=1/90000,setpts=RTCTIME*9/100,drawtext=text='%{pts\:hms}':fontsize=48:x=10:y=10"
+//     -c:v libx264 -preset ultrafast -tune zerolatency -g 30
+//     -muxdelay 0 -muxpreload 0 -f mpegts udp://127.0.0.1:5600
+// setpts stamps each frame with its capture time in 90 kHz ticks; the MPEG-TS pts wrap
+// is undone against the local wall clock. The burned-in time allows a camera-pointed-at-
+// screen check as well.
+
+// Decode and latency counters, published by the decode and render threads
+struct VideoStats {
+    uint32_t frames_decoded;
+    uint32_t frames_displayed;
+    uint32_t frames_dropped;        // overwritten in the mailbox before the UI took them
+    float decode_ms_avg;            // avcodec_send_packet until the frame is received
+    float decode_ms_max;
+    float latency_ms_avg;           // av_read_frame return until texture upload
+    float latency_ms_max;
+    int decode_threads;             // granted by the VideoScheduler
+    int state;                      // VideoState
+    uint32_t connect_attempts;
+    uint32_t reconnects;            // successful reconnections after a loss
+    uint32_t backoff_ms;            // delay before the next attempt while reconnecting
+    float last_reconnect_ms;        // connection lost -> first frame after reconnecting
+    float last_outage_ms;           // last packet before the loss -> first frame after it
+};
+
+// How much of a stream the UI is showing. Streams that aren't fully visible
+// get less decode work: thumbnails skip non-reference frames and hidden
+// streams decode keyframes only, which keeps them warm for a quick switch.
+enum VideoVisibility {
+    VIDEO_VISIBLE,
+    VIDEO_THUMBNAIL,
+    VIDEO_HIDDEN
+};
+
+// Shares a fixed budget of decoder threads between all open streams, so
+// several cameras can't oversubscribe the cores the render and transport
+// threads need. Thread-safe; streams acquire on open and release on close.
+class VideoScheduler {
+public:
+    // 0 = hardware threads minus one for the render thread
+    explicit VideoScheduler(int max_decode_threads = 0);
+
+    // Grant up to requested threads (0 = an even share), at least 1
+    int acquire(int requested);
+    void release(int granted);
+
+    int max_decode_threads() const { return m_max; }
+    int threads_in_use() const;
+
+private:
+    mutable std::mutex m_mutex;
+    int m_max;
+    int m_in_use;
+    int m_streams;
+};
+
+// A decoded frame plus when its packet was read and when it was decoded
+struct DecodedFrame {
+    AVFrame *frame;
+    uint64_t demux_us;
+    uint64_t decoded_us;
+    int64_t source_us;      // capture time from the stream clock modulo the pts wrap, or -1
+};
+
+// One camera: a supervised worker thread that connects, demuxes and decodes
+// into a triple-buffer mailbox, and a texture the render thread uploads the
+// newest frame into. The worker owns the format and codec contexts for their
+// whole life; other threads only see the mailbox, atomics and locked stats.
+// If the stream drops, the worker reconnects with exponential backoff; an
+// AVIOInterruptCB with a deadline makes a dead socket give up promptly.
+// open/update/texture/on_present/close are render-thread calls; the stats,
+// visibility and recording calls may come from any thread.
+class VideoStream {
+public:
+    VideoStream(const char *name, VideoScheduler &scheduler);
+    ~VideoStream();
+
+    // Start the worker and wait for the first connection attempt to finish
+    bool open(const char *url, SDL_Renderer *renderer, const VideoOptions &options = VideoOptions());
+    // Start the worker and return immediately
+    void open_async(const char *url, SDL_Renderer *renderer, const VideoOptions &options = VideoOptions());
+    void close();
+
+    // Called on the decode thread after each published frame, e.g. to wake
+    // the main loop. Set before open.
+    void set_frame_callback(std::function<void()> callback) { m_frame_callback = callback; }
+
+    // Is a decoded frame waiting for update()?
+    bool has_new_frame() const { return m_mailbox.has_update(); }
+
+    // Upload the newest decoded frame, if any. Returns true if the texture changed.
+    bool update();
+    SDL_Texture *texture() const { return m_texture; }
+
+    const std::string &name() const { return m_name; }
+    bool is_initialized() const { return m_initialized.load(); }
+    int state() const { return m_state.load(); }
+    void get_stats(VideoStats &stats) const;
+
+    // Takes effect on the decode thread's next packet
+    void set_visibility(VideoVisibility visibility) { m_visibility.store(visibility); }
+
+    // Instrumentation mode: call right after SDL_RenderPresent so the frame
+    // uploaded in this iteration gets its present timestamp
+    void on_present();
+    bool is_instrumented() const { return m_options.instrument; }
+    void get_latency(VideoLatencySnapshot &snapshot) const;
+    bool dump_latency_csv(const char *path) const;
+
+    // Recording: remux this camera's packets to disk on the recorder's writer thread.
+    // Starts at the next keyframe; takes effect on the decode thread's next packet.
+    void start_recording(const RecordingOptions &options);
+    void stop_recording();
+    void get_recording_stats(RecordingStats &stats) const;
+
+private:
+    enum RecordRequest { RECORD_NONE, RECORD_START, RECORD_STOP };
+
+    // Receipt times of recent packets, looked up by pts when their frame comes out
+    // of the decoder (which may reorder or hold frames back)
+    struct PacketTime {
+        int64_t pts;
+        uint64_t demux_us;
+    };
+    static const int PACKET_TIMES = 32;
+
+    bool start(SDL_Renderer *renderer, const VideoOptions &options);
+    void supervise(std::string url);
+    bool open_stream(const char *url);
+    void close_stream();
+    uint32_t decode_loop();
+    void set_io_deadline(uint64_t deadline_us) { m_io_deadline_us.store(deadline_us); }
+    void apply_visibility();
+    void handle_record_request();
+    uint64_t demux_time_for(int64_t pts, uint64_t fallback_us) const;
+    AVFrame *convert_frame(const AVFrame *frame);
+    void free_converter();
+    void upload_packed(const AVFrame *frame, int bytes_per_row);
+    static int interrupt_callback(void *opaque);
+
+    std::string m_name;
+    VideoScheduler &m_scheduler;
+    VideoOptions m_options;
+    std::function<void()> m_frame_callback;
+
+    // Decode thread state. Only the decode thread touches these while it is running.
+    AVFormatContext *m_fmt_ctx;
+    AVCodecContext *m_codec_ctx;
+    int m_stream_index;
+    AVPacket *m_pkt;
+    int m_granted_threads;
+    int m_applied_visibility;
+    PacketTime m_packet_times[PACKET_TIMES];
+    int m_packet_time_next;
+    std::atomic<int64_t> m_source_wrap_us;  // pts wrap period, for the source clock
+
+    // Newest decoded frame, handed from the decode thread to the render thread.
+    // Frames the render thread didn't pick up in time are overwritten, never queued.
+    TripleBuffer<DecodedFrame> m_mailbox;
+    std::thread m_decode_thread;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_initialized;
+    std::atomic<int> m_visibility;
+
+    // Worker supervision. The interrupt callback aborts any blocking FFmpeg call
+    // once m_io_deadline_us passes or close() clears m_running.
+    std::atomic<int> m_state;
+    std::atomic<uint64_t> m_io_deadline_us;
+    std::atomic<uint64_t> m_last_packet_us;
+    uint64_t m_lost_us;             // worker only: when the last connection dropped, 0 if none
+    uint64_t m_lost_last_packet_us;
+    bool m_first_attempt_done;      // guarded by m_state_mutex
+    std::mutex m_state_mutex;
+    std::condition_variable m_state_cv;  // backoff sleeps and open() wait on it
+
+    VideoRecorder m_recorder;
+    std::atomic<int> m_record_request;
+    mutable std::mutex m_record_mutex;
+    RecordingOptions m_record_options;
+
+    // Render thread state
+    SDL_Renderer *m_renderer;
+    SDL_Texture *m_texture;
+    int m_tex_w, m_tex_h;
+    Uint32 m_tex_format;
+    // Fallback for decoder formats SDL can't take natively: converted to YUV420P
+    // into m_conv, with the SwsContext and buffer reused until the frame geometry changes.
+    SwsContext *m_sws;
+    AVFrame *m_conv;
+    int m_sws_src_fmt;
+    bool m_sws_src_full_range;
+    // Instrumentation: the frame uploaded since the last present
+    VideoLatencyProbe m_latency;
+    FrameTimestamps m_pending;
+    bool m_have_pending;
+    int64_t m_pending_source_us;
+
+    mutable std::mutex m_stats_mutex;
+    VideoStats m_stats;
+};
@@ -0,0 +1,102 @@
+#include "video_latency.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+VideoLatencyProbe::VideoLatencyProbe() {
+    reset();
+}
+
+void VideoLatencyProbe::reset() {
+    memset(m_frames, 0, sizeof(m_frames));
+    m_count = 0;
+    m_next = 0;
+}
+
+void VideoLatencyProbe::on_presented(const FrameTimestamps& frame) {
+    m_frames[m_next] = frame;
+    m_next = (m_next + 1) % WINDOW;
+    if (m_count < WINDOW) {
+        m_count++;
+    }
+}
+
+static float span_ms(uint64_t from_us, uint64_t to_us) {
+    return to_us > from_us ? (float)(to_us - from_us) / 1000.0f : 0.0f;
+}
+
+static void percentiles(float* values, uint32_t count, LatencyPercentiles& out) {
+    memset(&out, 0, sizeof(out));
+    if (count == 0) {
+        return;
+    }
+    std::sort(values, values + count);
+    out.p50_ms = values[(count - 1) * 50 / 100];
+    out.p95_ms = values[(count - 1) * 95 / 100];
+    out.p99_ms = values[(count - 1) * 99 / 100];
+    out.max_ms = values[count - 1];
+}
+
+void VideoLatencyProbe::snapshot(VideoLatencySnapshot& out) const {
+    memset(&out, 0, sizeof(out));
+    out.samples = m_count;
+
+    float decode[WINDOW], handoff[WINDOW], present[WINDOW], total[WINDOW], glass[WINDOW];
+    uint32_t glass_count = 0;
+    for (uint32_t i = 0; i < m_count; i++) {
+        const FrameTimestamps& f = m_frames[i];
+        decode[i] = span_ms(f.demux_us, f.decoded_us);
+        handoff[i] = span_ms(f.decoded_us, f.upload_us);
+        present[i] = span_ms(f.upload_us, f.present_us);
+        total[i] = span_ms(f.demux_us, f.present_us);
+        if (f.glass_us >= 0) {
+            glass[glass_count++] = (float)f.glass_us / 1000.0f;
+        }
+    }
+    percentiles(decode, m_count, out.decode);
+    percentiles(handoff, m_count, out.handoff);
+    percentiles(present, m_count, out.present);
+    percentiles(total, m_count, out.total);
+    out.glass_samples = glass_count;
+    percentiles(glass, glass_count, out.glass);
+}
+
+static void write_summary(FILE* f, const char* stage, const LatencyPercentiles& p) {
+    fprintf(f, "# %s,%.3f,%.3f,%.3f,%.3f\n", stage, p.p50_ms, p.p95_ms, p.p99_ms, p.max_ms);
+}
+
+bool VideoLatencyProbe::dump_csv(const char* path) const {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+
+    fprintf(f, "frame,demux_us,decode_ms,handoff_ms,present_ms,total_ms,glass_ms\n");
+    uint32_t oldest = (m_next + WINDOW - m_count) % WINDOW;
+    for (uint32_t n = 0; n < m_count; n++) {
+        const FrameTimestamps& fr = m_frames[(oldest + n) % WINDOW];
+        fprintf(f, "%u,%llu,%.3f,%.3f,%.3f,%.3f,",
+            n, (unsigned long long)fr.demux_us,
+            span_ms(fr.demux_us, fr.decoded_us), span_ms(fr.decoded_us, fr.upload_us),
+            span_ms(fr.upload_us, fr.present_us), span_ms(fr.demux_us, fr.present_us));
+        if (fr.glass_us >= 0) {
+            fprintf(f, "%.3f\n", (double)fr.glass_us / 1000.0);
+        } else {
+            fprintf(f, "\n");
+        }
+    }
+
+    VideoLatencySnapshot snap;
+    snapshot(snap);
+    fprintf(f, "# stage,p50_ms,p95_ms,p99_ms,max_ms\n");
+    write_summary(f, "decode", snap.decode);
+    write_summary(f, "handoff", snap.handoff);
+    write_summary(f, "present", snap.present);
+    write_summary(f, "total", snap.total);
+    if (snap.glass_samples > 0) {
+        write_summary(f, "glass", snap.glass);
+    }
+
+    fclose(f);
+    return true;
+}
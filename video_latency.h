@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+// Timestamps of one displayed video frame. Steady-clock microseconds, except
+// glass_us which is derived from the source's wall clock.
+struct FrameTimestamps {
+    uint64_t demux_us;      // av_read_frame returned the packet
+    uint64_t decoded_us;    // avcodec_receive_frame returned the frame
+    uint64_t upload_us;     // texture upload finished
+    uint64_t present_us;    // SDL_RenderPresent returned
+    int64_t glass_us;       // source capture -> present; -1 without a source clock
+                            // or when the source clock is ahead of ours
+};
+
+struct LatencyPercentiles {
+    float p50_ms;
+    float p95_ms;
+    float p99_ms;
+    float max_ms;
+};
+
+// Per-stage latency distribution over the most recent VideoLatencyProbe::WINDOW frames
+struct VideoLatencySnapshot {
+    uint32_t samples;
+    LatencyPercentiles decode;    // packet receipt -> decoded
+    LatencyPercentiles handoff;   // decoded -> texture upload (mailbox wait + upload)
+    LatencyPercentiles present;   // texture upload -> SDL_RenderPresent
+    LatencyPercentiles total;     // packet receipt -> SDL_RenderPresent
+    uint32_t glass_samples;
+    LatencyPercentiles glass;     // source capture -> SDL_RenderPresent
+};
+
+// Collects per-frame pipeline timestamps and reduces them to percentiles.
+// Not thread-safe; the render thread owns it.
+class VideoLatencyProbe {
+public:
+    VideoLatencyProbe();
+
+    void reset();
+
+    // Record a frame once SDL_RenderPresent has returned for it
+    void on_presented(const FrameTimestamps& frame);
+
+    // Compute the current percentiles (sorts the window)
+    void snapshot(VideoLatencySnapshot& out) const;
+
+    // Write the frames in the window, oldest first, plus a percentile summary
+    bool dump_csv(const char* path) const;
+
+    static const uint32_t WINDOW = 1024;  // frames
+
+private:
+    FrameTimestamps m_frames[WINDOW];
+    uint32_t m_count;
+    uint32_t m_next;
+};
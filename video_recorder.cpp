@@ -0,0 +1,273 @@
+#include "video_recorder.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+VideoRecorder::VideoRecorder()
+    : m_queued_bytes(0), m_dropped(0), m_queue_peak(0), m_need_keyframe(true),
+      m_codecpar(nullptr), m_time_base{1, 90000}, m_out(nullptr),
+      m_file_start_dts(0), m_last_dts(AV_NOPTS_VALUE), m_file_bytes(0), m_file_index(0),
+      m_running(false), m_stop(false) {
+    m_stats = RecordingStats();
+}
+
+VideoRecorder::~VideoRecorder() {
+    request_stop();
+    join();
+    if (m_codecpar) {
+        avcodec_parameters_free(&m_codecpar);
+    }
+}
+
+bool VideoRecorder::start(const AVStream* stream, const RecordingOptions& options) {
+    join();
+
+    if (!m_codecpar) {
+        m_codecpar = avcodec_parameters_alloc();
+        if (!m_codecpar) {
+            return false;
+        }
+    }
+    if (avcodec_parameters_copy(m_codecpar, stream->codecpar) < 0) {
+        return false;
+    }
+    m_time_base = stream->time_base;
+    m_options = options;
+    m_file_index = 0;
+    m_need_keyframe = true;
+    m_queued_bytes.store(0);
+    m_dropped.store(0);
+    m_queue_peak.store(0);
+    {
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        m_stats = RecordingStats();
+        m_stats.recording = true;
+    }
+
+    m_stop.store(false, std::memory_order_release);
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&VideoRecorder::run, this);
+    return true;
+}
+
+void VideoRecorder::push(const AVPacket* pkt) {
+    if (!m_running.load(std::memory_order_acquire) || m_stop.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // Every file, and every resume after a drop, starts on a keyframe
+    bool key = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+    if (m_need_keyframe && !key) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (m_queued_bytes.load(std::memory_order_acquire) + (uint64_t)pkt->size > QUEUE_BYTES) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        m_need_keyframe = true;
+        return;
+    }
+
+    // New reference to the demuxer's buffer; the payload is not copied
+    AVPacket* ref = av_packet_clone(pkt);
+    if (!ref || !m_queue.push(ref)) {
+        if (ref) {
+            av_packet_free(&ref);
+        }
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        m_need_keyframe = true;
+        return;
+    }
+    m_need_keyframe = false;
+    m_queued_bytes.fetch_add((uint64_t)pkt->size, std::memory_order_release);
+
+    uint32_t depth = (uint32_t)m_queue.size();
+    if (depth > m_queue_peak.load(std::memory_order_relaxed)) {
+        m_queue_peak.store(depth, std::memory_order_relaxed);
+    }
+}
+
+void VideoRecorder::request_stop() {
+    m_stop.store(true, std::memory_order_release);
+}
+
+void VideoRecorder::join() {
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    drop_queued();
+}
+
+void VideoRecorder::drop_queued() {
+    AVPacket* pkt;
+    while (m_queue.pop(pkt)) {
+        av_packet_free(&pkt);
+    }
+    m_queued_bytes.store(0);
+}
+
+void VideoRecorder::get_stats(RecordingStats& stats) const {
+    {
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        stats = m_stats;
+    }
+    stats.packets_dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.queue_peak = m_queue_peak.load(std::memory_order_relaxed);
+}
+
+void VideoRecorder::run() {
+    for (;;) {
+        AVPacket* pkt;
+        if (m_queue.pop(pkt)) {
+            m_queued_bytes.fetch_sub((uint64_t)pkt->size, std::memory_order_release);
+            write_packet(pkt);
+            av_packet_free(&pkt);
+            continue;
+        }
+        if (m_stop.load(std::memory_order_acquire)) {
+            // Packets pushed just before the stop request are still written
+            while (m_queue.pop(pkt)) {
+                m_queued_bytes.fetch_sub((uint64_t)pkt->size, std::memory_order_release);
+                write_packet(pkt);
+                av_packet_free(&pkt);
+            }
+            break;
+        }
+        // Latency doesn't matter here; the queue absorbs the wait
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    close_file();
+    {
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        m_stats.recording = false;
+        m_stats.current_file.clear();
+    }
+    m_running.store(false, std::memory_order_release);
+}
+
+bool VideoRecorder::open_file() {
+    time_t now = time(nullptr);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", localtime(&now));
+    char name[64];
+    snprintf(name, sizeof(name), "_%s_%03u.%s", stamp, m_file_index, m_options.matroska ? "mkv" : "mp4");
+    std::string path = m_options.directory + "/" + m_options.prefix + name;
+
+    if (avformat_alloc_output_context2(&m_out, nullptr, m_options.matroska ? "matroska" : "mp4", path.c_str()) < 0) {
+        fprintf(stderr, "Recorder: no muxer for %s\n", path.c_str());
+        m_out = nullptr;
+        return false;
+    }
+
+    AVStream* stream = avformat_new_stream(m_out, nullptr);
+    if (!stream || avcodec_parameters_copy(stream->codecpar, m_codecpar) < 0) {
+        fprintf(stderr, "Recorder: failed to set up stream\n");
+        avformat_free_context(m_out);
+        m_out = nullptr;
+        return false;
+    }
+    stream->codecpar->codec_tag = 0;
+    stream->time_base = m_time_base;
+
+    if (avio_open(&m_out->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+        fprintf(stderr, "Recorder: failed to open %s\n", path.c_str());
+        avformat_free_context(m_out);
+        m_out = nullptr;
+        return false;
+    }
+
+    // Fragmented MP4 stays playable if the GUI dies mid-dive
+    AVDictionary* opts = nullptr;
+    if (!m_options.matroska) {
+        av_dict_set(&opts, "movflags", "+frag_keyframe+empty_moov+default_base_moof", 0);
+    }
+    int ret = avformat_write_header(m_out, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        fprintf(stderr, "Recorder: failed to write header to %s\n", path.c_str());
+        avio_closep(&m_out->pb);
+        avformat_free_context(m_out);
+        m_out = nullptr;
+        return false;
+    }
+
+    m_file_index++;
+    m_file_bytes = 0;
+    m_last_dts = AV_NOPTS_VALUE;
+
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_stats.files++;
+    m_stats.current_file = path;
+    return true;
+}
+
+void VideoRecorder::close_file() {
+    if (!m_out) {
+        return;
+    }
+    av_write_trailer(m_out);
+    avio_closep(&m_out->pb);
+    avformat_free_context(m_out);
+    m_out = nullptr;
+}
+
+void VideoRecorder::write_packet(AVPacket* pkt) {
+    if (pkt->dts == AV_NOPTS_VALUE) {
+        pkt->dts = pkt->pts;
+    }
+    if (pkt->dts == AV_NOPTS_VALUE) {
+        return;  // nothing to place it on the timeline with
+    }
+    bool key = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+
+    // Rotate only on a keyframe, so every file starts decodable
+    if (m_out && key) {
+        int64_t elapsed_s = av_rescale_q(pkt->dts - m_file_start_dts, m_time_base, AVRational{1, 1});
+        if ((m_options.rotate_bytes > 0 && m_file_bytes >= m_options.rotate_bytes) ||
+            (m_options.rotate_seconds > 0 && elapsed_s >= (int64_t)m_options.rotate_seconds)) {
+            close_file();
+        }
+    }
+    if (!m_out) {
+        if (!key || !open_file()) {
+            return;
+        }
+        m_file_start_dts = pkt->dts;
+    }
+
+    // Each file's timeline starts at zero; keep dts strictly increasing for the muxer
+    pkt->dts -= m_file_start_dts;
+    if (pkt->pts != AV_NOPTS_VALUE) {
+        pkt->pts -= m_file_start_dts;
+    }
+    av_packet_rescale_ts(pkt, m_time_base, m_out->streams[0]->time_base);
+    if (m_last_dts != AV_NOPTS_VALUE && pkt->dts <= m_last_dts) {
+        pkt->dts = m_last_dts + 1;
+    }
+    if (pkt->pts == AV_NOPTS_VALUE || pkt->pts < pkt->dts) {
+        pkt->pts = pkt->dts;
+    }
+    m_last_dts = pkt->dts;
+    pkt->stream_index = 0;
+    pkt->pos = -1;
+
+    int size = pkt->size;
+    if (av_write_frame(m_out, pkt) < 0) {
+        // Give up on this file; the next keyframe opens a fresh one
+        close_file();
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        m_stats.write_errors++;
+        return;
+    }
+    m_file_bytes += (uint64_t)size;
+
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_stats.packets_written++;
+    m_stats.bytes_written += (uint64_t)size;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "spsc_queue.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+extern "C" {
+#include <libavutil/rational.h>
+}
+
+struct AVCodecParameters;
+struct AVFormatContext;
+struct AVPacket;
+struct AVStream;
+
+// Where and how the camera stream is recorded
+struct RecordingOptions {
+    std::string directory = ".";
+    std::string prefix = "rov";     // file names are <prefix>_<date>_<time>_<index>.<ext>
+    bool matroska = false;          // .mkv instead of fragmented .mp4
+    uint64_t rotate_bytes = 0;      // start a new file past this size; 0 = never
+    uint32_t rotate_seconds = 0;    // start a new file past this duration; 0 = never
+};
+
+// Recorder counters, published by the writer thread
+struct RecordingStats {
+    bool recording;
+    uint32_t files;                 // files opened since start
+    uint64_t packets_written;
+    uint64_t bytes_written;         // payload bytes, all files
+    uint32_t packets_dropped;       // queue full, or discarded while waiting for a keyframe
+    uint32_t queue_peak;            // deepest the packet queue got
+    uint32_t write_errors;
+    std::string current_file;
+};
+
+// Remuxes compressed packets into MP4/MKV files on its own writer thread.
+// Packets are passed by reference (av_packet_ref), never decoded or re-encoded.
+// The producer is the demux thread: it pushes into a bounded SPSC queue and
+// never waits, so slow disk I/O drops recorded packets instead of stalling the
+// live picture. After a drop the recording resumes at the next keyframe.
+class VideoRecorder {
+public:
+    VideoRecorder();
+    ~VideoRecorder();
+
+    // Producer side: start a writer thread for this stream. Joins a previous
+    // writer first, which has normally finished flushing by then.
+    bool start(const AVStream* stream, const RecordingOptions& options);
+
+    // Producer side: queue a packet of the recorded stream
+    void push(const AVPacket* pkt);
+
+    // Producer side: ask the writer to flush the queue and close the file. Does not wait.
+    void request_stop();
+
+    // Wait for the writer to finish. Call after the producer has stopped pushing.
+    void join();
+
+    bool is_recording() const { return m_running.load(std::memory_order_acquire); }
+
+    void get_stats(RecordingStats& stats) const;
+
+    static const size_t QUEUE_PACKETS = 512;
+    static const uint64_t QUEUE_BYTES = 32 * 1024 * 1024;  // bounds memory at high bitrates
+
+private:
+    void run();
+    bool open_file();
+    void close_file();
+    void write_packet(AVPacket* pkt);
+    void drop_queued();
+
+    SPSCQueue<AVPacket*, QUEUE_PACKETS> m_queue;
+    std::atomic<uint64_t> m_queued_bytes;
+    std::atomic<uint32_t> m_dropped;
+    std::atomic<uint32_t> m_queue_peak;
+    bool m_need_keyframe;           // producer only
+
+    // Writer thread state
+    RecordingOptions m_options;
+    AVCodecParameters* m_codecpar;
+    AVRational m_time_base;
+    AVFormatContext* m_out;
+    int64_t m_file_start_dts;       // input time base
+    int64_t m_last_dts;             // output time base
+    uint64_t m_file_bytes;
+    uint32_t m_file_index;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stop;
+
+    mutable std::mutex m_stats_mutex;
+    RecordingStats m_stats;
+};